@@ -0,0 +1,142 @@
+#ifndef BYTESCAN_H
+#define BYTESCAN_H
+/*
+ * Copyright (C) 2022 Earl Johnson
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Earl Johnson https://github.com/earl-sudo/lilcxx 2022
+ */
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define BYTESCAN_SSE2 1
+#endif
+#if defined(BYTESCAN_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  include <immintrin.h>
+#  define BYTESCAN_AVX2 1 // Built for any x86, used when the cpu running it has AVX2.
+#  define BYTESCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace EjUtil {
+
+    // Find the first byte of a string in (or not in) a set of bytes given as ranges, 32 bytes at a time with AVX2
+    // when the cpu has it, else 16 at a time with SSE2, else a byte at a time.  Used by the parser and list
+    // serializer to skip runs of plain text. #optimization
+    //
+    //   size_t i = findFirstOf<byteIs(' '), byteIs('\t')>(s, n); // Index of first space or tab, n if none.
+    //
+    // Ranges have to be below 0x7F (bytes are compared signed), single bytes can be anything.
+    struct ByteRange { // #class
+        unsigned char lo_;
+        unsigned char hi_;
+    };
+    constexpr ByteRange byteIs(char c) { return {static_cast<unsigned char>(c), static_cast<unsigned char>(c)}; }
+    constexpr ByteRange byteIn(char lo, char hi) { return {static_cast<unsigned char>(lo), static_cast<unsigned char>(hi)}; }
+
+    namespace ByteScan {
+        template<ByteRange... RS>
+        constexpr bool inSet(unsigned char b) { return ((b >= RS.lo_ && b <= RS.hi_) || ...); }
+
+#ifdef BYTESCAN_SSE2
+        template<ByteRange R>
+        inline __m128i matchSse2(__m128i v) {
+            if constexpr (R.lo_ == R.hi_) {
+                return _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(R.lo_)));
+            } else {
+                static_assert(R.lo_ < R.hi_ && R.hi_ < 0x7F, "ranges must be below 0x7F");
+                return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(R.lo_ - 1))),
+                                     _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(R.hi_ + 1))));
+            }
+        }
+        // Bit mask of the 16 bytes at p in the set.
+        template<ByteRange... RS>
+        inline uint32_t maskSse2(const char* p) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i m = _mm_setzero_si128();
+            ((m = _mm_or_si128(m, matchSse2<RS>(v))), ...);
+            return static_cast<uint32_t>(_mm_movemask_epi8(m));
+        }
+#endif
+#ifdef BYTESCAN_AVX2
+        template<ByteRange R>
+        BYTESCAN_TARGET_AVX2 inline __m256i matchAvx2(__m256i v) {
+            if constexpr (R.lo_ == R.hi_) {
+                return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(static_cast<char>(R.lo_)));
+            } else {
+                return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(R.lo_ - 1))),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(R.hi_ + 1)), v));
+            }
+        }
+        // Look at s[i..n) 32 bytes at a time, true with i on the first match else i is where less than 32 are left.
+        template<bool NOT, ByteRange... RS>
+        BYTESCAN_TARGET_AVX2 bool findAvx2(const char* s, size_t n, size_t& i) {
+            for (; i + 32 <= n; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+                __m256i m = _mm256_setzero_si256();
+                ((m = _mm256_or_si256(m, matchAvx2<RS>(v))), ...);
+                auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+                if (NOT) { mask = ~mask; }
+                if (mask) {
+                    i += static_cast<size_t>(std::countr_zero(mask));
+                    return true;
+                }
+            }
+            return false;
+        }
+        inline bool hasAvx2() {
+            static const bool has = [] {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") != 0;
+            }();
+            return has;
+        }
+#endif
+
+        template<bool NOT, ByteRange... RS>
+        inline size_t find(const char* s, size_t n) {
+            size_t i = 0;
+#ifdef BYTESCAN_AVX2
+            if (n >= 32 && hasAvx2() && findAvx2<NOT, RS...>(s, n, i)) { return i; }
+#endif
+#ifdef BYTESCAN_SSE2
+            for (; i + 16 <= n; i += 16) {
+                uint32_t mask = maskSse2<RS...>(s + i);
+                if (NOT) { mask = ~mask & 0xFFFF; }
+                if (mask) { return i + static_cast<size_t>(std::countr_zero(mask)); }
+            }
+#endif
+            for (; i < n; i++) {
+                if (inSet<RS...>(static_cast<unsigned char>(s[i])) != NOT) { return i; }
+            }
+            return n;
+        }
+    } // namespace ByteScan
+
+    // Index of the first byte of s[0..n) in the set or n.
+    template<ByteRange... RS>
+    inline size_t findFirstOf(const char* s, size_t n) { return ByteScan::find<false, RS...>(s, n); }
+    // Index of the first byte of s[0..n) not in the set or n.
+    template<ByteRange... RS>
+    inline size_t findFirstNotOf(const char* s, size_t n) { return ByteScan::find<true, RS...>(s, n); }
+} // namespace EjUtil
+
+#endif //BYTESCAN_H
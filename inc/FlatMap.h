@@ -0,0 +1,281 @@
+#ifndef FLATMAP_H
+#define FLATMAP_H
+/*
+ * Copyright (C) 2022 Earl Johnson
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Earl Johnson https://github.com/earl-sudo/lilcxx 2022
+ */
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define FLATMAP_SSE2 1
+#endif
+
+namespace EjUtil {
+
+    // Open addressing hashtable in the style of SwissTable.  Slots live in one array and a control byte per slot
+    // says if it is empty, deleted or full and for full ones keeps 7 bits of the hash, so a probe checks 16 slots at
+    // a time (with SSE2 when there is some) and only compares keys whose 7 bits match.  #optimization
+    //
+    // Differences from std::unordered_map:
+    //   - Elements are std::pair<K,V> kept by value in the slots so K and V must be default constructible and
+    //     movable, don't change first.
+    //   - Growing moves the elements so it invalidates iterators and references, erase doesn't.
+    //   - find()/contains() take any type Hash and Eq take when both have is_transparent (heterogeneous lookup).
+    template<typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+    class FlatMap {
+    public:
+        using key_type    = K;
+        using mapped_type = V;
+        using value_type  = std::pair<K,V>;
+        using size_type   = size_t;
+    private:
+        static constexpr size_t GROUP = 16; // Slots checked at a time.
+        enum : int8_t { EMPTY = -128, DELETED = -2 }; // Control bytes of not full slots, full is 0..127.
+
+        std::unique_ptr<int8_t[]>     ctrl_;  // Control byte of each slot.
+        std::unique_ptr<value_type[]> slots_; // The elements.
+        size_t capacity_   = 0; // Number of slots, 0 or a power of 2 >= GROUP.
+        size_t size_       = 0; // Number of full slots.
+        size_t growthLeft_ = 0; // Number of EMPTY slots that can still be used before growing.
+        Hash   hash_;
+        Eq     eq_;
+
+        template<typename Q>
+        static constexpr bool IS_TRANSPARENT = requires { typename Hash::is_transparent; typename Eq::is_transparent; };
+
+        static size_t  h1(size_t hash) { return hash >> 7; }
+        static int8_t  h2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+        static size_t  maxLoad(size_t cap) { return cap - cap / 8; } // 7/8 full.
+        size_t numGroups() const { return capacity_ / GROUP; }
+
+        // Bit mask of slots in group whose control byte is c.
+        uint32_t match(size_t group, int8_t c) const {
+            const int8_t* p = &ctrl_[group * GROUP];
+#ifdef FLATMAP_SSE2
+            __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(c))));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP; i++) {
+                if (p[i] == c) { mask |= 1u << i; }
+            }
+            return mask;
+#endif
+        }
+        // Bit mask of slots in group which are EMPTY or DELETED.
+        uint32_t matchFree(size_t group) const {
+            const int8_t* p = &ctrl_[group * GROUP];
+#ifdef FLATMAP_SSE2
+            __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            return static_cast<uint32_t>(_mm_movemask_epi8(ctrl)); // Only not full ones have the high bit set.
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP; i++) {
+                if (p[i] < 0) { mask |= 1u << i; }
+            }
+            return mask;
+#endif
+        }
+        static size_t lowestBit(uint32_t mask) { return static_cast<size_t>(std::countr_zero(mask)); }
+
+        // Get slot of key or capacity_ if it isn't there.
+        template<typename Q>
+        size_t findIndex(const Q& key) const {
+            if (size_ == 0) { return capacity_; }
+            size_t hash  = hash_(key);
+            int8_t tag   = h2(hash);
+            size_t gmask = numGroups() - 1;
+            size_t group = h1(hash) & gmask;
+            for (size_t step = 1; ; step++) { // Triangular probing visits every group.
+                for (uint32_t m = match(group, tag); m; m &= m - 1) {
+                    size_t index = group * GROUP + lowestBit(m);
+                    if (eq_(slots_[index].first, key)) { return index; }
+                }
+                if (match(group, EMPTY)) { return capacity_; } // Key would have been put here.
+                group = (group + step) & gmask;
+            }
+        }
+        // Get first EMPTY or DELETED slot for hash.  There must be one.
+        size_t findFree(size_t hash) const {
+            size_t gmask = numGroups() - 1;
+            size_t group = h1(hash) & gmask;
+            for (size_t step = 1; ; step++) {
+                if (uint32_t m = matchFree(group)) { return group * GROUP + lowestBit(m); }
+                group = (group + step) & gmask;
+            }
+        }
+        // Rebuild with newCapacity slots, drops DELETED ones.
+        void rehash(size_t newCapacity) {
+            auto   oldCtrl  = std::move(ctrl_);
+            auto   oldSlots = std::move(slots_);
+            size_t oldCap   = capacity_;
+            capacity_   = newCapacity;
+            ctrl_       = std::make_unique<int8_t[]>(capacity_);
+            slots_      = std::make_unique<value_type[]>(capacity_);
+            std::memset(ctrl_.get(), EMPTY, capacity_);
+            growthLeft_ = maxLoad(capacity_) - size_;
+            for (size_t i = 0; i < oldCap; i++) {
+                if (oldCtrl[i] < 0) { continue; }
+                size_t hash  = hash_(oldSlots[i].first);
+                size_t index = findFree(hash);
+                ctrl_[index]  = h2(hash);
+                slots_[index] = std::move(oldSlots[i]);
+            }
+        }
+        // Put new key in a free slot, growing if needed.  Key must not be there.
+        size_t insertIndex(K&& key) {
+            size_t hash = hash_(key);
+            if (capacity_ == 0) { rehash(GROUP); }
+            size_t index = findFree(hash);
+            if (growthLeft_ == 0 && ctrl_[index] == EMPTY) {
+                // Full of elements or DELETED, grow if elements are the problem or clean up DELETED.
+                rehash((size_ + 1 > maxLoad(capacity_) / 2) ? (capacity_ * 2) : capacity_);
+                index = findFree(hash);
+            }
+            if (ctrl_[index] == EMPTY) { growthLeft_--; }
+            ctrl_[index] = h2(hash);
+            slots_[index].first = std::move(key);
+            size_++;
+            return index;
+        }
+        void eraseIndex(size_t index) {
+            size_t group = index / GROUP;
+            // A probe stops at a group with an EMPTY slot, so only make this slot EMPTY if one already is. #magic
+            if (match(group, EMPTY)) {
+                ctrl_[index] = EMPTY;
+                growthLeft_++;
+            } else {
+                ctrl_[index] = DELETED;
+            }
+            slots_[index] = value_type();
+            size_--;
+        }
+
+        template<typename VT, typename MAP>
+        class Iter {
+            friend class FlatMap;
+            MAP*   map_   = nullptr;
+            size_t index_ = 0;
+            void skipFree() { while (index_ < map_->capacity_ && map_->ctrl_[index_] < 0) { index_++; } }
+        public:
+            Iter() = default;
+            Iter(MAP* map, size_t index) : map_(map), index_(index) { skipFree(); }
+            operator Iter<const VT, const MAP>() const { return {map_, index_}; }
+            VT& operator*() const { return map_->slots_[index_]; }
+            VT* operator->() const { return &map_->slots_[index_]; }
+            Iter& operator++() { index_++; skipFree(); return *this; }
+            bool operator==(const Iter& other) const { return index_ == other.index_; }
+            bool operator!=(const Iter& other) const { return index_ != other.index_; }
+        };
+    public:
+        using iterator       = Iter<value_type, FlatMap>;
+        using const_iterator = Iter<const value_type, const FlatMap>;
+
+        FlatMap() = default;
+        FlatMap(FlatMap&&) noexcept = default;
+        FlatMap& operator=(FlatMap&&) noexcept = default;
+        FlatMap(const FlatMap& other) { *this = other; }
+        FlatMap& operator=(const FlatMap& other) {
+            if (this == &other) { return *this; }
+            capacity_   = other.capacity_;
+            size_       = other.size_;
+            growthLeft_ = other.growthLeft_;
+            ctrl_.reset();
+            slots_.reset();
+            if (capacity_) {
+                ctrl_  = std::make_unique<int8_t[]>(capacity_);
+                slots_ = std::make_unique<value_type[]>(capacity_);
+                std::memcpy(ctrl_.get(), other.ctrl_.get(), capacity_);
+                for (size_t i = 0; i < capacity_; i++) {
+                    if (ctrl_[i] >= 0) { slots_[i] = other.slots_[i]; }
+                }
+            }
+            return *this;
+        }
+
+        iterator       begin()       { return {this, 0}; }
+        iterator       end()         { return {this, capacity_}; }
+        const_iterator begin() const { return {this, 0}; }
+        const_iterator end()   const { return {this, capacity_}; }
+
+        size_t size()  const { return size_; }
+        bool   empty() const { return size_ == 0; }
+        // Remove all elements, keeps the slots for reuse.
+        void   clear() {
+            for (size_t i = 0; i < capacity_; i++) {
+                if (ctrl_[i] >= 0) { slots_[i] = value_type(); }
+            }
+            if (capacity_) { std::memset(ctrl_.get(), EMPTY, capacity_); }
+            size_       = 0;
+            growthLeft_ = capacity_ ? maxLoad(capacity_) : 0;
+        }
+        // Make room for n elements without growing.
+        void   reserve(size_t n) {
+            size_t cap = GROUP;
+            while (maxLoad(cap) < n) { cap *= 2; }
+            if (cap > capacity_) { rehash(cap); }
+        }
+
+        template<typename Q = K> requires (std::is_same_v<Q,K> || IS_TRANSPARENT<Q>)
+        iterator find(const Q& key) { return {this, findIndex(key)}; }
+        template<typename Q = K> requires (std::is_same_v<Q,K> || IS_TRANSPARENT<Q>)
+        const_iterator find(const Q& key) const { return {this, findIndex(key)}; }
+        template<typename Q = K> requires (std::is_same_v<Q,K> || IS_TRANSPARENT<Q>)
+        bool contains(const Q& key) const { return findIndex(key) != capacity_; }
+
+        // Insert key with value if key isn't there, returns where key is and if it was inserted.
+        std::pair<iterator,bool> emplace(K key, V value) {
+            size_t index = findIndex(key);
+            if (index != capacity_) { return {iterator(this, index), false}; }
+            index = insertIndex(std::move(key));
+            slots_[index].second = std::move(value);
+            return {iterator(this, index), true};
+        }
+        V& operator[](const K& key) {
+            size_t index = findIndex(key);
+            if (index == capacity_) { index = insertIndex(K(key)); }
+            return slots_[index].second;
+        }
+        // Remove element at it, returns iterator to the one after it.
+        iterator erase(iterator it) {
+            eraseIndex(it.index_);
+            ++it;
+            return it;
+        }
+        template<typename Q = K> requires (std::is_same_v<Q,K> || IS_TRANSPARENT<Q>)
+        size_t erase(const Q& key) {
+            size_t index = findIndex(key);
+            if (index == capacity_) { return 0; }
+            eraseIndex(index);
+            return 1;
+        }
+    };
+} // namespace EjUtil
+
+#endif //FLATMAP_H
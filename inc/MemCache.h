@@ -22,90 +22,147 @@
  * Earl Johnson https://github.com/earl-sudo/lilcxx 2022
  */
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
 #include <cstdlib>
 #include <cstdint>
-#include <list>
+#include <new>
+#include <vector>
 
 namespace EjUtil {
 
+    // Pool of memory for TN objects.  Memory comes from blocks of itemsInBlock_ items and freed items go on an
+    // intrusive free list kept in their own memory, so get()/put() don't allocate unless a new block is needed.
+    // get() gives raw memory for one TN, constructing it is up to the caller (e.g. a class operator new).
+    // Use one per thread: get(), put() and orphan() are for the thread that owns it only, other threads give items
+    // back with putRemote() (see ownerOf()).
     template<typename TN>
     struct MemCache {
     private:
-        std::list<TN*>      blocks_; // Memory blocks which contain memory for multiple TN.
-        std::list<TN*>      freeList_; // List of memory blocks to give when needed.
-        void addToFreeList(TN* block) {
-            for (size_t i = 0; i < itemsInBlock_; i++) {
-                freeList_.push_back(&block[i]);
-            }
+        struct Item { // Memory of one TN and the cache it came from, while free it holds the free list link.
+            MemCache* owner_;
+            union {
+                Item* next_;
+                alignas(TN) unsigned char mem_[sizeof(TN)];
+            };
+        };
+        struct Block {
+            Item*  items_;
+            size_t numItems_;
+        };
+        std::vector<Block>  blocks_; // Memory blocks which contain memory for multiple TN, sorted by address.
+        Item*               freeList_ = nullptr; // Free items to give when needed.
+        std::atomic<Item*>  remoteList_{nullptr}; // Items given back by other threads, taken by get() when needed.
+        // Items given back by other threads, after orphan() it counts up to 0 as the items still out come back.
+        std::atomic<int64_t> numRemoteFree_{0};
+        bool                orphaned_ = false; // Owning thread is done with it.
+        static Item* itemOf(TN* in) {
+            return reinterpret_cast<Item*>(reinterpret_cast<unsigned char*>(in) - offsetof(Item, mem_));
         }
         void addBlock() { // Add block and split into freeList.
-            auto block = (TN*)calloc(itemsInBlock_, sizeof(TN));
-            addToFreeList(block);
-            blocks_.push_back(block);
+            auto items = static_cast<Item*>(calloc(itemsInBlock_, sizeof(Item)));
+            if (items == nullptr) { throw std::bad_alloc(); }
+            for (size_t i = itemsInBlock_; i-- > 0; ) {
+                items[i].owner_ = this;
+                items[i].next_  = freeList_;
+                freeList_       = &items[i];
+            }
+            Block block{items, itemsInBlock_};
+            blocks_.insert(std::upper_bound(blocks_.begin(), blocks_.end(), block,
+                                            [](const Block& a, const Block& b) { return a.items_ < b.items_; }), block);
         }
     public:
-        bool                turnOff_ = false; // Just use normal calloc()/free().
-        size_t              itemsInBlock_ = 16; // How many blocks in each allocation.
-        bool                createBlocksAsNeeded_ = true; // Create block of objects when freeListEmpty.
+        bool                turnOff_ = false; // Just use normal calloc()/free(), set before first get().
+        size_t              itemsInBlock_ = 64; // How many items in each block allocated.
         // Stats
         size_t              numAllocated_ = 0;
         size_t              numFree_ = 0;
         size_t              maxNumCreated_ = 0;
-        size_t              numNoneCacheCreated_ = 0;
+        size_t              numNoneCacheCreated_ = 0; // Items made by calloc(), alone or in a block.
+        size_t              numHits_ = 0;   // get() given a free item.
+        size_t              numMisses_ = 0; // get() needing a new block.
 
-        void init() { if (turnOff_) return; addBlock();  }
-        MemCache() {
-            for (auto item : freeList_) {
-                if (!fromBlock(item)) {
-                    free(item);
-                }
-            }
-            for (auto block : blocks_) {
-                free(block);
+        MemCache() = default;
+        MemCache(const MemCache&) = delete;
+        MemCache& operator=(const MemCache&) = delete;
+        ~MemCache() {
+            // Items still in use would be left pointing at freed memory, leaking them is the lesser evil.
+            if (!orphaned_ && numAllocated_ != numFree_ + static_cast<size_t>(numRemoteFree_.load())) return;
+            for (auto& block : blocks_) {
+                free(block.items_);
             }
         }
-        bool fromBlock(const TN* in) const { // Check that address is one of our memory objects, i.e. from freeList.
-            auto inAddress = (uint64_t)in;
-            for (auto block : blocks_) {
-                auto blockAddress = (uint64_t)block;
-                if (blockAddress > inAddress) continue; // before block
-                if (inAddress > (blockAddress + itemsInBlock_ * sizeof(TN))) continue; // past block
-                if ((inAddress - blockAddress) % sizeof(TN) != 0) continue; // wrong alignment.
-                return true;
-            }
-            return false;
+        // Cache that item in came from (any thread).
+        [[nodiscard]] static MemCache* ownerOf(TN* in) { return itemOf(in)->owner_; }
+        void init() { if (turnOff_) return; addBlock();  }
+        [[nodiscard]] bool hasFree() const { return freeList_ != nullptr; }
+        [[nodiscard]] bool fromBlock(const TN* in) const { // Check that address is one of our memory objects.
+            auto inAddress = reinterpret_cast<uintptr_t>(itemOf(const_cast<TN*>(in)));
+            auto it = std::upper_bound(blocks_.begin(), blocks_.end(), inAddress,
+                                       [](uintptr_t a, const Block& b) { return a < reinterpret_cast<uintptr_t>(b.items_); });
+            if (it == blocks_.begin()) return false; // before first block
+            --it;
+            auto blockAddress = reinterpret_cast<uintptr_t>(it->items_);
+            if (inAddress >= (blockAddress + it->numItems_ * sizeof(Item))) return false; // past block
+            return (inAddress - blockAddress) % sizeof(Item) == 0; // alignment.
         }
         TN* get() {
             numAllocated_++;
+            auto numAlive = (numAllocated_ - numFree_);
+            if (numAlive > maxNumCreated_) maxNumCreated_ = numAlive;
             if (turnOff_) {
                 numNoneCacheCreated_++;
-                return (TN*)calloc(1, sizeof(TN));
+                auto ret = static_cast<Item*>(calloc(1, sizeof(Item)));
+                if (ret == nullptr) { throw std::bad_alloc(); }
+                ret->owner_ = this;
+                return reinterpret_cast<TN*>(ret->mem_);
             }
-            if (!freeList_.empty()) {
-                auto ret = freeList_.back();
-                freeList_.pop_back();
-                return ret;
+            if (freeList_ == nullptr) { freeList_ = remoteList_.exchange(nullptr, std::memory_order_acquire); }
+            if (freeList_ != nullptr) {
+                numHits_++;
+            } else {
+                numMisses_++;
+                addBlock();
+                numNoneCacheCreated_ += itemsInBlock_;
             }
-            if (!createBlocksAsNeeded_) {
-                numNoneCacheCreated_++;
-                return (TN *) calloc(1, sizeof(TN));
-            }
-            addBlock();
-            numNoneCacheCreated_ += itemsInBlock_;
-            auto ret = freeList_.back();
-            freeList_.pop_back();
-            return ret;
+            auto ret  = freeList_;
+            freeList_ = ret->next_;
+            return reinterpret_cast<TN*>(ret->mem_);
         }
         void put(TN* returned) {
+            assert(ownerOf(returned) == this);
             numFree_++;
-            auto numAlive = (numAllocated_ - numFree_);
-            if (numAlive > maxNumCreated_) maxNumCreated_ = numAlive;
+            auto item = itemOf(returned);
             if (turnOff_) {
-                free(returned);
+                free(item);
                 return;
             }
-            freeList_.push_back(returned);
+            assert(fromBlock(returned));
+            item->next_ = freeList_;
+            freeList_   = item;
+        }
+        // Give back item from a thread that doesn't own this.  Returns true if the cache was orphaned and this was the
+        // last item out, then the caller deletes the cache.
+        [[nodiscard]] bool putRemote(TN* returned) {
+            assert(ownerOf(returned) == this);
+            auto item = itemOf(returned);
+            if (turnOff_) {
+                free(item);
+            } else {
+                item->next_ = remoteList_.load(std::memory_order_relaxed);
+                while (!remoteList_.compare_exchange_weak(item->next_, item, std::memory_order_release,
+                                                          std::memory_order_relaxed)) { }
+            }
+            return numRemoteFree_.fetch_add(1, std::memory_order_acq_rel) + 1 == 0; // Last use of this.
+        }
+        // Owning thread is done with the cache.  Returns true if no items are out, then the caller deletes the
+        // cache, otherwise the putRemote() of the last one does.
+        [[nodiscard]] bool orphan() {
+            orphaned_ = true;
+            auto numOut = static_cast<int64_t>(numAllocated_ - numFree_); // Includes the ones given back by putRemote().
+            return numRemoteFree_.fetch_sub(numOut, std::memory_order_acq_rel) - numOut == 0;
         }
     };
 } // namespace EjUtil
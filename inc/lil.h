@@ -166,6 +166,8 @@ typedef const struct Lil_list*  Lil_list_CPtr;
 typedef struct LilInterp*       LilInterp_Ptr;
 
 using lil_func_proc_t = std::function<Lil_value_Ptr(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr* argv)>;
+// Binary command as a plain function called with the ctx it was registered with, see lil_register_fn(). #optimization
+typedef Lil_value_Ptr (*lil_cmd_fn_t)(void* ctx, LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr* argv);
 using Lil_func_Ptr    = std::shared_ptr<Lil_func>;
 
 typedef LILCALLBACK void    (*lil_exit_callback_proc_t)(LilInterp_Ptr lil, Lil_value_Ptr arg);
@@ -182,6 +184,7 @@ LILAPI ND LilInterp_Ptr    lil_new();
 LILAPI void                lil_free(LilInterp_Ptr lil);
 
 LILAPI /*ND*/ bool         lil_register(LilInterp_Ptr lil, lcstrp name, lil_func_proc_t proc);
+LILAPI /*ND*/ bool         lil_register_fn(LilInterp_Ptr lil, lcstrp name, lil_cmd_fn_t fn, void* ctx);
 
 LILAPI ND Lil_value_Ptr    lil_parse(LilInterp_Ptr lil, lcstrp code, INT codelen, INT funclevel);
 LILAPI ND Lil_value_Ptr    lil_parse_value(LilInterp_Ptr lil, Lil_value_Ptr val, INT funclevel);
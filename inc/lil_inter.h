@@ -36,6 +36,10 @@
 #include <list>
 #include <unordered_map>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <bitset>
+#include <algorithm>
 
 #include <cstdlib>
 #include <cstdio>
@@ -49,6 +53,7 @@
 
 #include "lil.h"
 #include "MemCache.h"
+#include "FlatMap.h"
 #include "string_format.h"
 
 #ifndef NS_BEGIN
@@ -242,12 +247,18 @@ struct FuncTimer { // #class
     };
 };
 
+// Lets hashtables keyed by lstring be searched with a lstring_view.
+struct Lil_strHash { // #class
+    using is_transparent = void;
+    size_t operator()(lstring_view s) const noexcept { return std::hash<lstring_view>{}(s); }
+};
+
 struct Coverage { // #class
     // Coverage specific ==================================================
     bool                doCoverage_ = false;
     std::ostream*       outStrm_ = nullptr;
 
-    std::unordered_map<lstring, INT>  coverageMap_;
+    std::unordered_map<lstring,INT,Lil_strHash,std::equal_to<>>  coverageMap_;
 
     Coverage() = default;
     Coverage(const Coverage& rhs) = default;
@@ -267,7 +278,7 @@ struct Coverage { // #class
     }
     void beenHere(lcstrp  name) {
         if (!doCoverage_) return;
-        auto it = coverageMap_.find(name);
+        auto it = coverageMap_.find(lstring_view(name));
         if (it == coverageMap_.end()) {
             coverageMap_[name] = 0;
             it = coverageMap_.find(name);
@@ -276,7 +287,17 @@ struct Coverage { // #class
     }
 };
 
-struct SysInfo { // #class
+// Settings of the caches and compilers.  Unlike the rest of SysInfo they are kept when Lil_getSysInfo(true) resets it,
+// they are still in use by the interps that are left.
+struct SysSettings { // #class
+    INT parseCacheMaxSize_    = 1024;   // Max entries in parsed code cache, 0 is off
+    INT parseCacheMaxCodeLen_ = 0x1000; // Longer code is parsed but not cached
+    INT funcBytecode_         = 1;      // Run func bodies as bytecode when they compile, 0 is off
+    INT exprCacheMaxSize_     = 1024;   // Max entries in compiled expression cache, 0 is off
+    INT countedLoops_         = 1;      // Run counted for/while loops with native integers, 0 is off
+};
+
+struct SysInfo : SysSettings { // #class
     ObjCounter  objCounter_;
     FuncTimer   funcTimer_;
     Coverage    converage_;
@@ -329,6 +350,35 @@ struct SysInfo { // #class
     INT numCmdSuccess_ = 0;
     INT numCmdFailed_ = 0;
 
+    INT numParseCacheHits_ = 0;
+    INT numParseCacheMisses_ = 0;
+    INT numBytecodeCompiles_ = 0;
+    INT numBytecodeFallbacks_ = 0;
+    INT numBytecodeRuns_ = 0;
+    INT numExprCacheHits_ = 0;
+    INT numExprCacheMisses_ = 0;
+    INT numExprFallbacks_ = 0;
+    INT numDirectVarReads_ = 0;
+    INT numCmdSiteHits_ = 0;
+    INT numCmdSiteMisses_ = 0;
+    INT numCmdTableChanges_ = 0; // Times a command table changed, see Lil_newCmdEpoch().
+    INT numSlotVars_ = 0;
+    INT numSymbols_ = 0;
+    INT numValueRepHits_ = 0;
+    INT numValueStrGens_ = 0;
+    INT numValueCowCopies_ = 0;
+    INT numListRepHits_ = 0;
+    INT numListRepBuilds_ = 0;
+    INT numListRepCopies_ = 0;
+    INT numListInPlace_ = 0;
+    INT numDictInPlace_ = 0;
+    INT numDictRehashes_ = 0;
+    INT numPoolHits_ = 0;   // new of a pooled object given freed memory.
+    INT numPoolMisses_ = 0; // new of a pooled object needing a new block.
+    INT numEnvReuses_ = 0;
+    INT numTailCalls_ = 0;
+    INT numCountedTests_ = 0;
+
     INT varHTinitSize_    = 0; // 0 is unset
     INT cmdHTinitSize_    = 0; // 0 is unset
     INT limit_ParseDepth_ = 0xFFFF; // 0 is off
@@ -390,6 +440,34 @@ struct SysInfo { // #class
         SYSINFO_ENTRY(numCmdSuccess_);
         SYSINFO_ENTRY(numCmdFailed_);
         //- 35
+        SYSINFO_ENTRY(numParseCacheHits_);
+        SYSINFO_ENTRY(numParseCacheMisses_);
+        SYSINFO_ENTRY(numBytecodeCompiles_);
+        SYSINFO_ENTRY(numBytecodeFallbacks_);
+        SYSINFO_ENTRY(numBytecodeRuns_);
+        SYSINFO_ENTRY(numExprCacheHits_);
+        SYSINFO_ENTRY(numExprCacheMisses_);
+        SYSINFO_ENTRY(numExprFallbacks_);
+        SYSINFO_ENTRY(numDirectVarReads_);
+        SYSINFO_ENTRY(numCmdSiteHits_);
+        SYSINFO_ENTRY(numCmdSiteMisses_);
+        SYSINFO_ENTRY(numCmdTableChanges_);
+        SYSINFO_ENTRY(numSlotVars_);
+        SYSINFO_ENTRY(numSymbols_);
+        SYSINFO_ENTRY(numValueRepHits_);
+        SYSINFO_ENTRY(numValueStrGens_);
+        SYSINFO_ENTRY(numValueCowCopies_);
+        SYSINFO_ENTRY(numListRepHits_);
+        SYSINFO_ENTRY(numListRepBuilds_);
+        SYSINFO_ENTRY(numListRepCopies_);
+        SYSINFO_ENTRY(numListInPlace_);
+        SYSINFO_ENTRY(numDictInPlace_);
+        SYSINFO_ENTRY(numDictRehashes_);
+        SYSINFO_ENTRY(numPoolHits_);
+        SYSINFO_ENTRY(numPoolMisses_);
+        SYSINFO_ENTRY(numEnvReuses_);
+        SYSINFO_ENTRY(numTailCalls_);
+        SYSINFO_ENTRY(numCountedTests_);
         SYSINFO_ENTRY(startTime_);
 #undef SYSINFO_ENTRY
     }
@@ -400,6 +478,119 @@ struct SysInfo { // #class
 // way to combine threads stats will be needed if you want to do that.
 SysInfo* Lil_getSysInfo(bool reset = false);
 
+// New command table epoch, never the same as one given out before in the process.  Lil_cmdSites outlive SysInfo
+// resets and are shared by interps (duplicate_cmds()) so epochs can't be counted per interp or in SysInfo.
+INT Lil_newCmdEpoch();
+
+// Most builtin commands there can be, see Lil_builtinIndex().
+constexpr size_t LIL_MAX_BUILTINS = 128; // #magic
+// Get index of builtin command name or -1 if it isn't one, uses a perfect hash made at compile time (see lil_cmds.cpp).
+ND INT Lil_builtinIndex(lstring_view name);
+
+struct Lil_symbolTable;
+
+// An interned name, there is one per distinct name in an interp so names compare by pointer. #optimization
+struct Lil_symbol { // #class
+    lstring name_;
+    size_t  hash_    = 0;  // Hash of name_, computed once.
+    INT     builtin_ = -1; // Lil_builtinIndex() of name_, computed once.
+    mutable Lil_symbolTable* table_ = nullptr; // Table that owns it, nullptr for the builtin symbols every table has.
+    mutable INT              refs_  = 0;       // Number of Lil_symRef to it, the table frees it when it drops to 0.
+};
+using Lil_sym = const Lil_symbol*;
+
+// Reference to a symbol that keeps it in its table, so generated names (like "set x$i") don't pile up. Variables and
+// functions name themselves by one, hashtables keyed by Lil_sym rely on their values to keep the key alive.
+class Lil_symRef { // #class
+    Lil_sym sym_ = nullptr;
+    void retain() const { if (sym_ && sym_->table_) { sym_->refs_++; } }
+    void release();
+public:
+    Lil_symRef() = default; // #ctor
+    Lil_symRef(Lil_sym sym) : sym_(sym) { retain(); } // #ctor
+    Lil_symRef(const Lil_symRef& rhs) : sym_(rhs.sym_) { retain(); }
+    Lil_symRef(Lil_symRef&& rhs) noexcept : sym_(rhs.sym_) { rhs.sym_ = nullptr; }
+    Lil_symRef& operator=(const Lil_symRef& rhs) {
+        if (this != &rhs) { Lil_symRef tmp(rhs); std::swap(sym_, tmp.sym_); }
+        return *this;
+    }
+    Lil_symRef& operator=(Lil_symRef&& rhs) noexcept {
+        std::swap(sym_, rhs.sym_);
+        return *this;
+    }
+    ~Lil_symRef() noexcept { release(); } // #dtor
+    operator Lil_sym() const { return sym_; }
+    Lil_sym operator->() const { return sym_; }
+};
+
+// Get symbols of the builtin command names by Lil_builtinIndex(), they are in every symbol table and never freed.
+const std::vector<Lil_symbol>& Lil_builtinSymbols();
+
+// Hash for hashtables keyed by Lil_sym.
+struct Lil_symHash { // #class
+    size_t operator()(Lil_sym sym) const noexcept { return sym->hash_; }
+};
+
+// Hashtable used for names.  Define LIL_STD_HASHMAPS to use the node based std::unordered_map to compare against.
+#ifdef LIL_STD_HASHMAPS
+template<typename K, typename V, typename HASH, typename EQ = std::equal_to<K>>
+using Lil_hashMap = std::unordered_map<K,V,HASH,EQ>;
+#else
+template<typename K, typename V, typename HASH, typename EQ = std::equal_to<K>>
+using Lil_hashMap = EjUtil::FlatMap<K,V,HASH,EQ>; // #optimization
+#endif
+
+// Symbols of variable and command names.  There is one per interp, shared with its child interps (see
+// LilInterp::symbols_), so an interp can be used by any thread as long as it's one at a time.  Builtin command names
+// are the Lil_builtinSymbols() in every table, so the builtin commands can be shared by all interps.
+struct Lil_symbolTable { // #class
+private:
+    using Sym_HashTable = Lil_hashMap<lstring_view,Lil_sym,Lil_strHash,std::equal_to<>>;
+    Sym_HashTable syms_; // Keys are views of the symbols name_, symbols with table_ this are owned.
+public:
+    Lil_symbolTable(); // #ctor
+    ~Lil_symbolTable() noexcept { // #dtor
+        for (const auto& n : syms_) {
+            if (n.second->table_ != this) { continue; }
+            if (n.second->refs_) {
+                n.second->table_ = nullptr; // Still referenced (by a Lil_func kept by the host), no longer counted.
+            } else {
+                delete n.second;
+            }
+        }
+    }
+    Lil_symbolTable(const Lil_symbolTable& rhs) = delete;
+    Lil_symbolTable& operator=(const Lil_symbolTable& rhs) = delete;
+
+    // Get symbol of name or nullptr if it was never interned, nothing can be named by it then.
+    ND Lil_sym find(lstring_view name) const {
+        auto it = syms_.find(name);
+        return (it == syms_.end()) ? nullptr : it->second;
+    }
+    // Get symbol of name, making it the first time.  It's freed once the last reference to it goes.
+    ND Lil_symRef intern(lstring_view name) {
+        auto it = syms_.find(name);
+        if (it != syms_.end()) { return it->second; }
+        auto sym = new Lil_symbol{lstring(name), Lil_strHash{}(name), Lil_builtinIndex(name), this};
+        Lil_getSysInfo()->numSymbols_++;
+        return syms_.emplace(lstring_view(sym->name_), sym).first->second;
+    }
+    // Get number of symbols, including the builtin ones.
+    ND size_t size() const { return syms_.size(); }
+    // Free symbol, called when its last Lil_symRef goes.
+    void erase(Lil_sym sym) {
+        assert(sym->table_ == this); assert(sym->refs_ == 0);
+        syms_.erase(lstring_view(sym->name_));
+        delete sym;
+    }
+};
+inline void Lil_symRef::release() {
+    if (sym_ && sym_->table_ && --sym_->refs_ == 0) { sym_->table_->erase(sym_); }
+    sym_ = nullptr;
+}
+// Get symbol table of lil.
+Lil_symbolTable& Lil_getSymbols(LilInterp_Ptr lil);
+
 #ifdef NO_OBJCOUNT
 #  define LIL_CTOR(SYSINFO, NAME)
 #  define LIL_DTOR(SYSINFO, NAME)
@@ -407,6 +598,13 @@ SysInfo* Lil_getSysInfo(bool reset = false);
 #  define LIL_CTOR(SYSINFO, NAME) if ((SYSINFO) && (SYSINFO)->objCounter_.logObjectCount_) (SYSINFO)->objCounter_.ctor((NAME))
 #  define LIL_DTOR(SYSINFO, NAME) if ((SYSINFO) && (SYSINFO)->objCounter_.logObjectCount_) (SYSINFO)->objCounter_.dtor((NAME))
 #endif
+// In a class gets its objects from a per thread EjUtil::MemCache (see lil.cpp) instead of the heap, they can be deleted
+// by any thread. #optimization
+#ifdef LIL_NO_POOLS
+#  define LIL_POOLED
+#else
+#  define LIL_POOLED static void* operator new(size_t size); static void operator delete(void* ptr, size_t size) noexcept;
+#endif
 #ifdef NO_BEENHERE
     #define LIL_BEENHERE_CMD(SYSINFO, NAME)
     #define LIL_BEENHERE_PROC(SYSINFO, NAME)
@@ -430,7 +628,12 @@ SysInfo* Lil_getSysInfo(bool reset = false);
 
 void setSysInfo(LilInterp_Ptr lil, SysInfo*& sysInfo);
 
+using Lil_listRep_Ptr = std::shared_ptr<Lil_list>;
+struct Lil_dict;
+using Lil_dictRep_Ptr = std::shared_ptr<Lil_dict>;
+
 struct Lil_value { // #class
+    LIL_POOLED
     SysInfo*    sysInfo_ = nullptr;
 private:
 #ifdef LIL_VALUE_STATS
@@ -440,7 +643,41 @@ private:
 #else
     void change() { }
 #endif
-    lstring     value_; // Body of value_. (Owns memory)
+    mutable lstring value_; // Body of value_ when it isn't shared. (Owns memory)
+    // #optimization Long bodies are shared by copies (lil_clone_value()) until one of them changes.
+    mutable std::shared_ptr<lstring> shared_; // Body when set, value_ is empty then.
+    static constexpr size_t SHARE_MIN_LEN = 64; // #magic Shorter bodies are cheaper to copy than share.
+    // #optimization Cached internal reps, so numbers don't get reparsed/reformatted on every use.
+    mutable bool     strValid_  = true;  // When false value_ is generated from intRep_/listRep_/dictRep_ on first read.
+    bool             isInt_     = false; // Value was made from an integer, intRep_ is exact.
+    mutable bool     hasIntRep_ = false; // intRep_/intRepErr_ hold result of lil_to_integer().
+    mutable bool     hasDblRep_ = false; // dblRep_/dblRepErr_ hold result of lil_to_double().
+    mutable bool     intRepErr_ = false;
+    mutable bool     dblRepErr_ = false;
+    mutable lilint_t intRep_    = 0;
+    mutable double   dblRep_    = 0;
+    mutable Lil_listRep_Ptr listRep_; // Words of value_ as a list, see _value_list(). (Shared with copies)
+    mutable Lil_dictRep_Ptr dictRep_; // value_ as a dictionary, see _value_dict(). (Shared with copies)
+    void genString() const;
+    const lstring& str() const {
+        if (!strValid_) { genString(); }
+        return shared_ ? *shared_ : value_;
+    }
+    // Body that can be changed, copied first if somebody else shares it.
+    lstring& body() {
+        str();
+        if (shared_) {
+            if (shared_.use_count() > 1) {
+                value_ = *shared_;
+                sysInfo_->numValueCowCopies_++;
+            } else {
+                value_ = std::move(*shared_);
+            }
+            shared_.reset();
+        }
+        return value_;
+    }
+    void dropReps() { isInt_ = hasIntRep_ = hasDblRep_ = false; listRep_.reset(); dictRep_.reset(); }
 public:
 
     explicit Lil_value(LilInterp_Ptr lil) {
@@ -448,7 +685,7 @@ public:
         setSysInfo(lil, sysInfo_);
         LIL_CTOR(sysInfo_, "Lil_value");
     }
-    Lil_value(LilInterp_Ptr lil, const lstring&  str) { // #ctor
+    Lil_value(LilInterp_Ptr lil, lstring_view  str) { // #ctor
         assert(lil!=nullptr);
         setSysInfo(lil, sysInfo_);
         LIL_CTOR(sysInfo_, "Lil_value");
@@ -459,19 +696,66 @@ public:
     Lil_value(const Lil_value& src) { // #ctor
         sysInfo_ = src.sysInfo_;
         LIL_CTOR(sysInfo_, "Lil_value");
-        this->value_ = src.value_; // alloc char*
+        if (!src.shared_ && src.value_.length() >= SHARE_MIN_LEN) { // Both share it from now on.
+            src.shared_ = std::make_shared<lstring>(std::move(src.value_));
+            src.value_.clear();
+        }
+        if (src.shared_) { this->shared_ = src.shared_; }
+        else { this->value_ = src.value_; } // alloc char*
+        strValid_  = src.strValid_;  isInt_     = src.isInt_;
+        hasIntRep_ = src.hasIntRep_; hasDblRep_ = src.hasDblRep_;
+        intRepErr_ = src.intRepErr_; dblRepErr_ = src.dblRepErr_;
+        intRep_    = src.intRep_;    dblRep_    = src.dblRep_;
+        listRep_   = src.listRep_;    dictRep_   = src.dictRep_;
     }
     ~Lil_value() noexcept { // #dtor
         LIL_DTOR(sysInfo_, "Lil_value");
     }
-    ND INT getValueLen() const { return value_.length(); }
-    ND const lstring& getValue() const { return value_; }
-    ND lchar  getChar(INT i) const { return value_.at(i); }
-    void append(lchar ch) { value_.append(1, ch); change(); }
-    void append(lcstrp  s, INT len) { assert(s!=nullptr); value_.append(s, len); change(); }
+    ND INT getValueLen() const { return str().length(); }
+    ND const lstring& getValue() const { return str(); }
+    ND lchar  getChar(INT i) const { return str().at(i); }
+    void append(lchar ch) { body().append(1, ch); dropReps(); change(); }
+    void append(lcstrp  s, INT len) { assert(s!=nullptr); body().append(s, len); dropReps(); change(); }
     void append(lcstrp  s) { assert(s!=nullptr); append(s); change(); }
-    void append(Lil_value_CPtr v) { assert(v!=nullptr); value_.append(v->value_);change(); }
-    ND INT getSize() const { return value_.length(); }
+    void append(Lil_value_CPtr v) { assert(v!=nullptr); body().append(v->str()); dropReps(); change(); }
+    ND INT getSize() const { return str().length(); }
+    // Make value an integer, its string is only generated when somebody asks for it.
+    void setInteger(lilint_t num) {
+        value_.clear(); shared_.reset(); strValid_ = false; isInt_ = true;
+        hasIntRep_ = true; intRepErr_ = false; intRep_ = num;
+        hasDblRep_ = false; listRep_.reset(); dictRep_.reset();
+    }
+    ND bool getExactInteger(lilint_t& num) const { if (isInt_) { num = intRep_; } return isInt_; }
+    ND bool getIntRep(lilint_t& num, bool& inError) const {
+        if (hasIntRep_) { num = intRep_; inError = intRepErr_; }
+        return hasIntRep_;
+    }
+    void cacheIntRep(lilint_t num, bool inError) const { hasIntRep_ = true; intRep_ = num; intRepErr_ = inError; }
+    ND bool getDoubleRep(double& num, bool& inError) const {
+        if (hasDblRep_) { num = dblRep_; inError = dblRepErr_; }
+        return hasDblRep_;
+    }
+    void cacheDoubleRep(double num, bool inError) const { hasDblRep_ = true; dblRep_ = num; dblRepErr_ = inError; }
+    ND const Lil_listRep_Ptr& getListRep() const { return listRep_; }
+    void cacheListRep(Lil_listRep_Ptr list) const { listRep_ = std::move(list); }
+    // Make value the list, its string is only generated when somebody asks for it.
+    void setList(Lil_listRep_Ptr list) {
+        assert(list!=nullptr);
+        value_.clear(); shared_.reset(); strValid_ = false;
+        dropReps(); listRep_ = std::move(list);
+    }
+    // The list of the value was changed in place, make the string again when it's needed.
+    void listChanged() { assert(listRep_!=nullptr); setList(listRep_); }
+    ND const Lil_dictRep_Ptr& getDictRep() const { return dictRep_; }
+    void cacheDictRep(Lil_dictRep_Ptr dict) const { dictRep_ = std::move(dict); }
+    // Make value the dictionary, its string is only generated when somebody asks for it.
+    void setDict(Lil_dictRep_Ptr dict) {
+        assert(dict!=nullptr);
+        value_.clear(); shared_.reset(); strValid_ = false;
+        dropReps(); dictRep_ = std::move(dict);
+    }
+    // The dictionary of the value was changed in place, make the string again when it's needed.
+    void dictChanged() { assert(dictRep_!=nullptr); setDict(dictRep_); }
 };
 
 struct Lil_value_SPtr { // #class
@@ -484,18 +768,21 @@ struct Lil_list_SPtr { // #class
     Lil_list_Ptr v = nullptr;
     explicit Lil_list_SPtr(Lil_list_Ptr vD) : v(vD) { assert(vD!=nullptr); } // #ctor
     ~Lil_list_SPtr() noexcept { lil_free_list(v); } // #dtor
+    // Give up ownership of list.
+    Lil_list_Ptr release() { auto r = v; v = nullptr; return r; }
 };
 
 struct Lil_var { // #class
+    LIL_POOLED
     SysInfo*            sysInfo_ = nullptr;
 private:
     lstring             watchCode_;
-    lstring             name_; // Variable named.
+    Lil_symRef          name_; // Variable named.
     Lil_callframe *     thisCallframe_ = nullptr; // Pointer to callframe defined in.
     Lil_value_Ptr       value_ = nullptr;
 public:
 
-    Lil_var(LilInterp_Ptr lil, lcstrp  nD, lstrp  wD, Lil_callframe* envD, Lil_value_Ptr vD) // vD, wD might be nullptr
+    Lil_var(LilInterp_Ptr lil, Lil_sym  nD, lstrp  wD, Lil_callframe* envD, Lil_value_Ptr vD) // vD, wD might be nullptr
             : name_(nD),  thisCallframe_(envD), value_(vD) { // #ctor
         assert(lil!=nullptr); assert(nD!=nullptr);  assert(envD!=nullptr);
         setSysInfo(lil, sysInfo_);
@@ -508,7 +795,9 @@ public:
     }
     bool serialize(SerializationFlags &flags);
     // Get variable name_.
-    ND const lstring& getName() const { return name_; }
+    ND const lstring& getName() const { return name_->name_; }
+    // Get variable name_ symbol.
+    ND Lil_sym getSym() const { return name_; }
     // Get variable value_.
     ND const lstring & getWatchCode() const { return watchCode_; }
     // Set variable value_.
@@ -532,21 +821,33 @@ public:
     ND Lil_callframe* getCallframe() const { return thisCallframe_; }
 };
 
+// Names of the variables of a compiled func that its callframes keep in slots instead of the hashmap. #optimization
+using Lil_slotNames_Ptr = std::shared_ptr<const std::vector<Lil_symRef>>;
+
 struct Lil_callframe { // #class
+    LIL_POOLED
     SysInfo*        sysInfo_ = nullptr;
 private:
     Lil_callframe * parent_ = nullptr; // Parent callframe.
+    Lil_symbolTable* symbols_ = nullptr; // Of the interp, variable names are looked up in it.
 
-    using Var_HashTable = std::unordered_map<lstring,Lil_var_Ptr>;
+    using Var_HashTable = Lil_hashMap<Lil_sym,Lil_var_Ptr,Lil_symHash>;
     Var_HashTable varmap_; // Hashmap of variables in callframe.
 
+    // A variable named in slotNames_ is only ever in its slot, never in varmap_. #optimization
+    Lil_slotNames_Ptr                         slotNames_; // Names of variables in slots_ (can be nullptr).
+    std::unique_ptr<std::optional<Lil_var>[]> slots_;     // Variables by slot, empty until set.
+    size_t                                    numSlots_ = 0; // Size of slots_, can be more than slotNames_ when reused.
+    static constexpr INT RETIRED_MAX_VARS = 64; // #magic Bigger varmap_ isn't worth keeping for reuse.
+
     Lil_func_Ptr  func_        = nullptr; // The function that generated this callframe.
     Lil_value_Ptr catcher_for_ = nullptr; // Exception catcher.
     Lil_value_Ptr retval_      = nullptr; // Return value_ from this callframe. (can be nullptr)
     bool          retval_set_  = false;   // Has the retval_ been set.
     bool          breakRun_ = false;
+    Lil_list_Ptr  tailCall_    = nullptr; // Words of command "tailcall" runs in place of func_ (own memory).
 public:
-    explicit Lil_callframe(LilInterp_Ptr lil) {
+    explicit Lil_callframe(LilInterp_Ptr lil) : symbols_(&Lil_getSymbols(lil)) {
         assert(lil!=nullptr);
         setSysInfo(lil, sysInfo_);
         LIL_CTOR(sysInfo_, "Lil_callframe");
@@ -554,7 +855,7 @@ public:
             varmap_.reserve(sysInfo_->varHTinitSize_);
         }
     }
-    explicit Lil_callframe(LilInterp_Ptr lil, Lil_callframe_Ptr parent) { // #ctor
+    explicit Lil_callframe(LilInterp_Ptr lil, Lil_callframe_Ptr parent) : symbols_(&Lil_getSymbols(lil)) { // #ctor
         assert(lil!=nullptr); assert(parent!=nullptr);
         setSysInfo(lil, sysInfo_);
         LIL_CTOR(sysInfo_, "Lil_callframe");
@@ -563,6 +864,7 @@ public:
     ~Lil_callframe() noexcept { // #dtor
         LIL_DTOR(sysInfo_, "Lil_callframe");
         lil_free_value(this->getReturnVal());
+        if (tailCall_) { lil_free_list(tailCall_); }
 
         for (const auto& n : varmap_) {
             delete (n.second); //delete Lil_var_Ptr
@@ -573,11 +875,103 @@ public:
     // Size commands hashtable.  #optimization
     void varmap_reserve(Var_HashTable::size_type sz) { varmap_.reserve(sz); }
 
+    // Empty callframe for reuse, frees variables and return value but varmap_ and slots_ keep their memory.
+    // See LilInterp::reuseEnv(). #optimization
+    void retire() {
+        lil_free_value(retval_);
+        retval_      = nullptr;
+        retval_set_  = false;
+        breakRun_    = false;
+        setTailCall(nullptr);
+        func_        = nullptr;
+        catcher_for_ = nullptr;
+        parent_      = nullptr;
+        for (const auto& n : varmap_) {
+            delete (n.second); //delete Lil_var_Ptr
+        }
+        if (std::ssize(varmap_) > RETIRED_MAX_VARS) { varmap_ = Var_HashTable(); } else { varmap_.clear(); }
+        for (size_t i = 0; slotNames_ && i < slotNames_->size(); i++) { slots_[i].reset(); }
+        slotNames_.reset();
+    }
+    // Use retired callframe as a new callframe of parent.
+    void reuse(Lil_callframe_Ptr parent) {
+        assert(parent!=nullptr); assert(parent_==nullptr);
+        parent_ = parent;
+    }
+
+    // Keep variables named by names in slots.  Only done before any variable is set.
+    void setSlots(const Lil_slotNames_Ptr& names) {
+        assert(names!=nullptr); assert(varmap_.empty()); assert(slotNames_==nullptr);
+        slotNames_ = names;
+        if (names->size() > numSlots_) {
+            slots_    = std::make_unique<std::optional<Lil_var>[]>(names->size());
+            numSlots_ = names->size();
+        }
+    }
+    // Get names of variables in slots (can be nullptr).
+    ND const Lil_slotNames_Ptr& getSlotNames() const { return slotNames_; }
+    // Get slot of variable name or -1.
+    ND INT findSlot(Lil_sym name) const {
+        if (!slotNames_) { return -1; }
+        auto& names = *slotNames_;
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i] == name) { return CAST(INT)i; }
+        }
+        return -1;
+    }
+    // Get variable in slot or nullptr if it isn't set.
+    ND Lil_var_Ptr getSlotVar(INT slot) const {
+        auto& var = slots_[CAST(size_t)slot];
+        return var ? &*var : nullptr;
+    }
+    // Create new variable, in its slot if it has one or the hashmap.
+    Lil_var_Ptr newVar(LilInterp_Ptr lil, lcstrp nameD, Lil_value_Ptr val) { // val might be nullptr
+        assert(lil!=nullptr); assert(nameD!=nullptr);
+        Lil_symRef name = symbols_->intern(nameD);
+        INT        slot = findSlot(name);
+        if (slot < 0) {
+            auto var = new Lil_var(lil, name, nullptr, this, val);
+            hashmap_put(name, var);
+            return var;
+        }
+        auto& var = slots_[CAST(size_t)slot];
+        var.reset();
+        var.emplace(lil, name, nullptr, this, val);
+        sysInfo_->numSlotVars_++;
+        return &*var;
+    }
+
     // Does variable exists.
-    bool varExists(lcstrp name) { assert(name!=nullptr); return varmap_.contains(name); }
+    bool varExists(lcstrp nameD) {
+        assert(nameD!=nullptr);
+        Lil_sym name = symbols_->find(nameD);
+        if (!name) { return false; }
+        INT slot = findSlot(name);
+        return slot < 0 ? varmap_.contains(name) : getSlotVar(slot) != nullptr;
+    }
     // Get a variable.
-    Lil_var_Ptr getVar(lcstrp name) {
+    Lil_var_Ptr getVar(lcstrp nameD) {
+        assert(nameD!=nullptr);
+        Lil_sym name = symbols_->find(nameD);
+        if (!name) {
+            sysInfo_->numVarMisses_++;
+            return nullptr;
+        }
+        return getVar(name);
+    }
+    // Get a variable by symbol.
+    Lil_var_Ptr getVar(Lil_sym name) {
         assert(name!=nullptr);
+        INT slot = findSlot(name);
+        if (slot >= 0) {
+            auto ret = getSlotVar(slot);
+            if (ret == nullptr) {
+                sysInfo_->numVarMisses_++;
+            } else {
+                sysInfo_->numVarHits_++;
+            }
+            return ret;
+        }
         auto it = varmap_.find(name);
         auto ret = (it == varmap_.end()) ? (nullptr) : (it->second);
         if (ret == nullptr) {
@@ -588,7 +982,7 @@ public:
         return ret;
     }
     // Add variable to hashmap.
-    void hashmap_put(lcstrp name, Lil_var_Ptr v) {
+    void hashmap_put(Lil_sym name, Lil_var_Ptr v) {
         assert(name!=nullptr); assert(v!=nullptr);
         varmap_[name] = v;
         auto sz = std::ssize(varmap_);
@@ -599,7 +993,8 @@ public:
     // Remove entry from hashmap
     void hashmap_remove(lcstrp name) {
         assert(name!=nullptr);
-        auto it = varmap_.find(name); if (it != varmap_.end()) varmap_.erase(it); }
+        Lil_sym sym = symbols_->find(name); if (!sym) return;
+        auto it = varmap_.find(sym); if (it != varmap_.end()) varmap_.erase(it); }
 
     // Get function which created this callstack.
     ND Lil_func_Ptr getFunc() const { return func_; }
@@ -615,8 +1010,11 @@ public:
 
     void varsNamesToList(LilInterp_Ptr lil, Lil_list_Ptr list) {
         assert(lil!=nullptr); assert(list!=nullptr);
+        for (INT i = 0; slotNames_ && i < std::ssize(*slotNames_); i++) {
+            if (getSlotVar(i)) { lil_list_append(list, new Lil_value(lil, (*slotNames_)[CAST(size_t)i]->name_)); }
+        }
         for (const auto& n : varmap_) {
-            lil_list_append(list, new Lil_value(lil, n.first));
+            lil_list_append(list, new Lil_value(lil, n.first->name_));
         }
     }
 
@@ -628,6 +1026,18 @@ public:
     ND bool getBreakrun() const { return breakRun_; }
     ND bool& setBreakrun() { return breakRun_; }
 
+    // Get words of the command to run in place of func_ and own them, nullptr if "tailcall" wasn't used.
+    ND Lil_list_Ptr takeTailCall() {
+        Lil_list_Ptr words = tailCall_;
+        tailCall_ = nullptr;
+        return words;
+    }
+    // Set words of the command to run in place of func_ once its code stops, owns them.
+    void setTailCall(Lil_list_Ptr words) {
+        if (tailCall_) { lil_free_list(tailCall_); }
+        tailCall_ = words;
+    }
+
     ND Lil_value_Ptr getCatcher_for() const { return catcher_for_; }
     void setCatcher_for(Lil_value_Ptr var) {
         catcher_for_ = var;
@@ -635,16 +1045,25 @@ public:
 };
 
 struct Lil_list { // #class
+    LIL_POOLED
     SysInfo*                   sysInfo_ = nullptr;
 private:
 #define LIL_LIST_IS_ARRAY 1
-    std::vector<Lil_value_Ptr> listRep_;
+    std::pmr::vector<Lil_value_Ptr> listRep_;
 public:
     explicit Lil_list(LilInterp_Ptr lil) { // #ctor
         assert(lil!=nullptr);
         setSysInfo(lil, sysInfo_);
         LIL_CTOR(sysInfo_, "Lil_list");
     }
+    // List whose array comes from mem, it must be freed before mem releases its memory.  #optimization
+    Lil_list(LilInterp_Ptr lil, std::pmr::memory_resource* mem) : listRep_(mem) { // #ctor
+        assert(lil!=nullptr); assert(mem!=nullptr);
+        setSysInfo(lil, sysInfo_);
+        LIL_CTOR(sysInfo_, "Lil_list");
+    }
+    Lil_list(const Lil_list&) = delete;
+    Lil_list& operator=(const Lil_list&) = delete;
     ~Lil_list() noexcept { // #dtor
         LIL_DTOR(sysInfo_, "Lil_list");
         for (auto v : listRep_) {
@@ -658,7 +1077,22 @@ public:
             sysInfo_->maxListLengthAchieved_ = std::ssize(listRep_); // #topic
     }
     ND Lil_value_Ptr getValue(INT index) const { return listRep_[index]; }
+    // Put val at index, the list takes val and frees the value that was there.
+    void setValue(INT index, Lil_value_Ptr val) {
+        assert(val!=nullptr);
+        lil_free_value(listRep_[index]);
+        listRep_[index] = val;
+    }
+    // Replace values from index "from" up to "to" with vals, the list takes vals.
+    void replace(INT from, INT to, const std::vector<Lil_value_Ptr>& vals) {
+        for (INT i = from; i < to; i++) { lil_free_value(listRep_[i]); }
+        listRep_.erase(listRep_.begin() + from, listRep_.begin() + to);
+        listRep_.insert(listRep_.begin() + from, vals.begin(), vals.end());
+        if (std::ssize(listRep_) > sysInfo_->maxListLengthAchieved_)
+            sysInfo_->maxListLengthAchieved_ = std::ssize(listRep_); // #topic
+    }
     ND INT getCount() const { return std::ssize(listRep_); }
+    void reserve(INT count) { listRep_.reserve(CAST(size_t)count); }
     // Cmds are list we skip first word which is the command name.
     Lil_value_Ptr* getArgs() { return (&listRep_[0]) + 1; }
     void convertListToArrayForArgs(std::vector<Lil_value_Ptr>& argsArray) {
@@ -678,15 +1112,306 @@ public:
     ND auto cend() const { return listRep_.cend(); }
 };
 
+// Dictionary of "dict" commands.  Items stay in the order their keys were first set, which gives the string
+// form "key value key value ...".  Keys are found through an open-addressing table (linear probing) of item
+// indices. #optimization
+struct Lil_dict { // #class
+    SysInfo*                   sysInfo_ = nullptr;
+    struct Item {
+        lstring       key_;
+        Lil_value_Ptr value_ = nullptr; // nullptr once the item is unset.
+        size_t        hash_  = 0;
+    };
+private:
+    static constexpr INT EMPTY = -1; // Slot never used.
+    static constexpr INT TOMB  = -2; // Slot of an unset item.
+    std::vector<Item> items_;
+    std::vector<INT>  slots_;        // Index in items_ or EMPTY/TOMB.  Size is 0 or a power of 2.
+    INT               numItems_ = 0; // Items not unset.
+    INT               numUsed_  = 0; // Slots not EMPTY.
+
+    ND size_t findSlot(lstring_view key, size_t hash) const {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            INT idx = slots_[i];
+            if (idx == EMPTY) { return i; }
+            if (idx >= 0 && items_[CAST(size_t)idx].hash_ == hash && items_[CAST(size_t)idx].key_ == key) { return i; }
+        }
+    }
+    // Drop unset items and make the table big enough for numItems_+1 items.
+    void rehash() {
+        std::erase_if(items_, [](const Item& item) { return item.value_ == nullptr; });
+        size_t size = 8; // #magic
+        while (size * 3 < CAST(size_t)(numItems_ + 1) * 4) { size *= 2; }
+        slots_.assign(size, EMPTY);
+        for (size_t idx = 0; idx < items_.size(); idx++) { slots_[findSlot(items_[idx].key_, items_[idx].hash_)] = CAST(INT)idx; }
+        numUsed_ = numItems_;
+        sysInfo_->numDictRehashes_++;
+    }
+public:
+    explicit Lil_dict(LilInterp_Ptr lil) { // #ctor
+        assert(lil!=nullptr);
+        setSysInfo(lil, sysInfo_);
+        LIL_CTOR(sysInfo_, "Lil_dict");
+    }
+    Lil_dict(const Lil_dict& src) : sysInfo_(src.sysInfo_), slots_(src.slots_), numItems_(src.numItems_), numUsed_(src.numUsed_) { // #ctor
+        LIL_CTOR(sysInfo_, "Lil_dict");
+        items_.reserve(src.items_.size());
+        for (auto& item : src.items_) { items_.push_back(Item{item.key_, lil_clone_value(item.value_), item.hash_}); }
+    }
+    Lil_dict& operator=(const Lil_dict&) = delete;
+    ~Lil_dict() noexcept { // #dtor
+        LIL_DTOR(sysInfo_, "Lil_dict");
+        for (auto& item : items_) { if (item.value_) { lil_free_value(item.value_); } }
+    }
+    ND INT getCount() const { return numItems_; }
+    // Value of key or nullptr.
+    ND Lil_value_Ptr get(lstring_view key) const {
+        if (slots_.empty()) { return nullptr; }
+        INT idx = slots_[findSlot(key, Lil_strHash{}(key))];
+        return idx >= 0 ? items_[CAST(size_t)idx].value_ : nullptr;
+    }
+    // Set key to val, the dictionary takes val.
+    void set(lstring_view key, Lil_value_Ptr val) {
+        assert(val!=nullptr);
+        if (CAST(size_t)(numUsed_ + 1) * 4 > slots_.size() * 3) { rehash(); }
+        size_t hash = Lil_strHash{}(key);
+        size_t slot = findSlot(key, hash);
+        INT    idx  = slots_[slot];
+        if (idx >= 0) {
+            lil_free_value(items_[CAST(size_t)idx].value_);
+            items_[CAST(size_t)idx].value_ = val;
+            return;
+        }
+        slots_[slot] = CAST(INT)items_.size();
+        items_.push_back(Item{lstring(key), val, hash});
+        numItems_++; numUsed_++;
+    }
+    // Remove key, false if there was no such key.
+    bool unset(lstring_view key) {
+        if (slots_.empty()) { return false; }
+        size_t slot = findSlot(key, Lil_strHash{}(key));
+        INT    idx  = slots_[slot];
+        if (idx < 0) { return false; }
+        auto& item = items_[CAST(size_t)idx];
+        lil_free_value(item.value_);
+        item.value_ = nullptr;
+        item.key_.clear();
+        slots_[slot] = TOMB;
+        numItems_--;
+        return true;
+    }
+    // Call func(key, value) for each item in order.
+    template<typename F> void forEach(F func) const {
+        for (auto& item : items_) { if (item.value_) { func(item.key_, item.value_); } }
+    }
+};
+
+// List of a value for reading.  It's the list cached on the value when there is one, else a substituted copy.
+struct Lil_listRef { // #class
+    Lil_listRep_Ptr v;
+    Lil_listRef(LilInterp_Ptr lil, Lil_value_Ptr val); // #ctor
+};
+
+// Code is tokenized once into this form and the result reused each time the same code runs again
+// (func bodies, loop bodies, if branches).  See lil_parse(). #optimization
+enum LIL_PART_TYPE {
+    LIL_PART_LITERAL, // Bare word or {...}, text_ used as is.
+    LIL_PART_BRACKET, // [...], text_ is code to run.
+    LIL_PART_DOLLAR,  // $name, parts_[0] is the name.
+    LIL_PART_QUOTE,   // "..." or '...', parts_ are concatenated.
+};
+
+struct Lil_parsedCode;
+using Lil_parsedCode_Ptr = std::shared_ptr<Lil_parsedCode>;
+
+struct Lil_parsedPart { // #class
+    LIL_PART_TYPE               type_      = LIL_PART_LITERAL;
+    bool                        wordStart_ = false; // First part of a word.
+    bool                        isOwn_     = false; // Text is in own_ instead of src_.
+    lstring_view                src_;   // Literal text or code of a bracket, slice of the parsed code. #optimization
+    lstring                     own_;   // Literal text of a quote piece an escape changed.
+    Lil_parsedCode_Ptr          code_;  // Parsed text of a bracket, done on first use.
+    std::vector<Lil_parsedPart> parts_; // Name of a dollar or pieces of a quote.
+
+    // Literal text or code of a bracket.
+    ND lstring_view text() const { return isOwn_ ? lstring_view(own_) : src_; }
+};
+
+// Command found by name at a call site, good until the command table changes (LilInterp::getCmdEpoch()).  Parsed
+// code can be shared by interps (i.e. funcs of "jaileval"), so epochs are unique across the interps of a thread.
+// #optimization
+struct Lil_cmdSite { // #class
+    Lil_func_Ptr cmd_;        // Command that was found, nullptr if none.
+    INT          epoch_ = -1; // Command table epoch cmd_ was found in.
+};
+
+struct Lil_parsedCmd { // #class
+    std::vector<Lil_parsedPart> parts_; // A word is the parts from one wordStart_ to the next appended.
+    INT                         head_       = 0;     // Position in code after the words.
+    bool                        parseError_ = false; // Parser couldn't proceed after parts_.
+    bool                        litName_    = false; // First word is literal text, so site_ can be used.
+    Lil_cmdSite                 site_;               // Command named by the first word.
+};
+
+struct Lil_parsedCode { // #class
+    lstring                    code_; // Code that was parsed. (own memory)
+    INT                        codeLen_   = 0;
+    bool                       ignoreEol_ = false; // EOL handling the code was parsed with.
+    std::vector<Lil_parsedCmd> cmds_;
+};
+
+// A func body can be compiled from its parsed code into bytecode run by a dispatch loop instead of
+// walking the parsed code, see _compile_func() and _run_bytecode().  Builtin if/while/for/foreach/set
+// are done inline as long as the command by that name is still the builtin. #optimization
+enum LIL_OPCODE {
+    LIL_OP_CMD,          // Start of a command, end block if in error.
+    LIL_OP_END_CMD,      // End of a command, end block if a "break-like" command was executed.
+    LIL_OP_HEAD,         // Move head to a_.
+    LIL_OP_PUSH_LIT,     // Push literal a_ as a word.
+    LIL_OP_PUSH_PART,    // Push part a_ evaluated the text way.
+    LIL_OP_LOAD_VAR,     // Push $name with name literal a_, part b_ if builtin c_ isn't "set" anymore.
+    LIL_OP_APPEND,       // Join top a_ words into one.
+    LIL_OP_CALL,         // Run command from top a_ words with head b_, command found at call site c_ or -1.
+    LIL_OP_STORE_VAR,    // set <literal a_> <top word> with head b_, builtin c_ is "set".
+    LIL_OP_GUARD,        // Jump to b_ if command isn't builtin a_ anymore.
+    LIL_OP_ENTER,        // Start block of code a_ that ends at b_ (like lil_parse()).
+    LIL_OP_LEAVE,        // End block.
+    LIL_OP_LEAVE_WORD,   // End block and push the result as a word (bracket).
+    LIL_OP_DROP,         // Free the result.
+    LIL_OP_JUMP,         // Jump to a_.
+    LIL_OP_JUMP_FALSE,   // Expression a_ false jump to b_, on error jump to c_.
+    LIL_OP_JUMP_TRUE,    // Expression a_ true jump to b_, on error jump to c_. ("bnot_")
+    LIL_OP_LOOP,         // Start while/for loop.
+    LIL_OP_LOOP_CHECK,   // Jump to a_ if in error or "break-like" command was executed.
+    LIL_OP_LOOP_BODY,    // Free last loop result before running the body again (like fnc_for/fnc_while).
+    LIL_OP_LOOP_KEEP,    // Result is new loop result.
+    LIL_OP_LOOP_END,     // End while/for loop, result is loop result or nothing if a_.
+    LIL_OP_FOREACH,      // Start foreach from top a_ words, jump to b_ if command isn't builtin c_ anymore.
+    LIL_OP_FOREACH_NEXT, // Set variable to next item or jump to a_.
+    LIL_OP_FOREACH_KEEP, // Add result, jump to a_ if in error or "break-like" command was executed.
+    LIL_OP_FOREACH_END,  // End foreach, result is list of results.
+    LIL_OP_BUILTIN_END,  // End of an inline builtin command.
+    LIL_OP_COUNT_TEST,   // Counted loop a_ condition false jump to b_, true jump to c_, can't tell go on.
+    LIL_OP_COUNT_STEP,   // Counted loop a_ step done natively jump to b_, else go on (to the step's code).
+};
+
+struct Lil_op { // #class
+    LIL_OPCODE op_ = LIL_OP_CMD;
+    INT        a_  = 0;
+    INT        b_  = 0;
+    INT        c_  = 0;
+};
+
+// Counted loop of while/for: condition "$name op limit" with limit an integer or "$name" and for a step
+// "inc name [by]" or "dec name [by]".  As long as the variables hold integers the condition and step are done with
+// native integers instead of lil_eval_expr() and running "inc", see _counted_test() and _counted_step().
+// #optimization
+enum LIL_COUNTED_OP { LIL_COUNT_LT, LIL_COUNT_LE, LIL_COUNT_GT, LIL_COUNT_GE, LIL_COUNT_EQ, LIL_COUNT_NE };
+
+struct Lil_countedLoop { // #class
+    lstring        var_;                // Loop variable.
+    LIL_COUNTED_OP op_          = LIL_COUNT_LT;
+    lstring        limitVar_;           // Variable with the limit or empty if limit is limit_.
+    lilint_t       limit_       = 0;
+    lstring        stepCmd_;            // "inc" or "dec", empty if there is no step.
+    lilint_t       by_          = 0;    // Added to var_ by the step.
+    INT            setBuiltin_  = -1;   // "set" and stepCmd_ in Lil_bytecode::builtins_ (bytecode only).
+    INT            stepBuiltin_ = -1;
+};
+
+struct Lil_bytecode { // #class
+    bool                                         fallback_ = false; // Couldn't compile, run the text way.
+    std::vector<Lil_op>                          ops_;
+    std::vector<lstring>                         lits_;     // Literal words.
+    std::vector<Lil_value_Ptr>                   exprs_;    // Literal expressions. (own memory)
+    std::vector<Lil_parsedPart*>                 parts_;    // Parts evaluated the text way, live in codes_.
+    std::vector<Lil_parsedCode_Ptr>              codes_;    // codes_[0] is the func body.
+    std::vector<std::pair<lstring,Lil_func_Ptr>> builtins_; // Commands done inline.
+    std::vector<Lil_cmdSite>                     builtinSites_; // Command now named by builtins_.
+    std::vector<Lil_cmdSite*>                    sites_;    // Call sites of commands, live in codes_.
+    Lil_slotNames_Ptr                            slotNames_; // Variables kept in slots of callframes (can be nullptr).
+    std::vector<INT>                             litSlots_; // Slot of literal as a variable name or -1.
+    std::vector<Lil_countedLoop>                 counted_;  // Counted while/for loops.
+    static const INT MAX_SLOTS = 32; // #magic
+    Lil_bytecode() = default;
+    Lil_bytecode(const Lil_bytecode&) = delete;
+    Lil_bytecode& operator=(const Lil_bytecode&) = delete;
+    ~Lil_bytecode() noexcept { // #dtor
+        for (auto v : exprs_) { lil_free_value(v); }
+    }
+};
+using Lil_bytecode_Ptr = std::shared_ptr<Lil_bytecode>;
+
+// An expression can be compiled from its text before substitution so evaluating it again is just running the
+// compiled nodes, see _ee_compile() and _ee_run().  Only "$name" substitutions are allowed and their values have to
+// be plain numbers when run, anything else is left to substituting and parsing the text. #optimization
+enum LIL_EXPR_OPCODE {
+    LIL_EXPR_CONST,  // Number already worked out.
+    LIL_EXPR_VAR,    // Value of variable a_.
+    LIL_EXPR_NEG,    // Unary '-'.
+    LIL_EXPR_BITNOT, // Unary '~'.
+    LIL_EXPR_NOT,    // Unary '!'.
+    LIL_EXPR_MUL,    // All binary operators are nodes a_ and b_.
+    LIL_EXPR_MOD,
+    LIL_EXPR_DIV,
+    LIL_EXPR_IDIV,   // '\\'
+    LIL_EXPR_ADD,
+    LIL_EXPR_SUB,
+    LIL_EXPR_SHL,
+    LIL_EXPR_SHR,
+    LIL_EXPR_LT,
+    LIL_EXPR_GT,
+    LIL_EXPR_LE,
+    LIL_EXPR_GE,
+    LIL_EXPR_EQ,
+    LIL_EXPR_NE,
+    LIL_EXPR_BITAND,
+    LIL_EXPR_BITOR,
+    LIL_EXPR_AND,
+    LIL_EXPR_OR,
+};
+
+struct Lil_exprNum { // #class
+    LilTypes type_       = EE_INT;
+    lilint_t integerVal_ = 0;
+    double   doubleVal_  = 0.0;
+};
+
+struct Lil_exprCell { // #class
+    lchar ch_  = 0;  // Character of substituted text.
+    INT   var_ = -1; // Or index of "$name" in Lil_exprProgram::vars_.
+};
+
+struct Lil_exprNode { // #class
+    LIL_EXPR_OPCODE op_ = LIL_EXPR_CONST;
+    INT             a_  = 0;
+    INT             b_  = 0;
+    Lil_exprNum     num_; // LIL_EXPR_CONST value.
+};
+
+struct Lil_exprProgram { // #class
+    static constexpr INT MAX_NODES = 128; // #magic
+    bool                      fallback_ = true; // Couldn't compile, substitute and parse the text.
+    std::vector<lstring>      vars_;           // Names of variables.
+    std::vector<Lil_exprNode> nodes_;          // Children come before parents, last one is the result.
+    Lil_func_Ptr              set_ = nullptr;  // Builtin "set" that "$name" has to still be.
+};
+using Lil_exprProgram_Ptr = std::shared_ptr<Lil_exprProgram>;
+
 struct Lil_func { // #class
-    lstring         name_; // Name of function.
+    Lil_symRef      name_; // Name of function, it keeps the cmdMap_ key alive.
     SysInfo*        sysInfo_ = nullptr;
 private:
     Lil_list_Ptr    argNames_ = nullptr; // List of arguments to function. Owns memory.
     Lil_value_Ptr   code_     = nullptr; // Body of function. Owns memory.
-    lil_func_proc_t proc_     = nullptr; // Function pointer to binary command.
+    Lil_parsedCode_Ptr parsedCode_;      // Parsed code_, reset when code_ changes.
+    Lil_bytecode_Ptr   bytecode_;        // Compiled code_, reset when code_ changes.
+    lil_func_proc_t proc_     = nullptr; // Function object of binary command, from lil_register().
+    lil_cmd_fn_t    fn_       = nullptr; // Function pointer of binary command, from lil_register_fn(). #optimization
+    void*           fnCtx_    = nullptr; // Given to fn_.
 public:
-    Lil_func(LilInterp_Ptr lil, lcstrp  nameD) : name_(nameD) { // #ctor
+    Lil_func(LilInterp_Ptr lil, lcstrp  nameD) : name_(Lil_getSymbols(lil).intern(nameD)) { // #ctor
         assert(lil!=nullptr); assert(nameD!=nullptr);
         setSysInfo(lil, sysInfo_);
         LIL_CTOR(sysInfo_, "Lil_func");
@@ -701,10 +1426,12 @@ public:
         if (this->getCode())     { lil_free_value(this->getCode()); }
         this->argNames_ = nullptr;
         this->code_     = nullptr;
+        this->parsedCode_.reset();
+        this->bytecode_.reset();
         this->setProc(nullptr);
     }
     // Get function name_.
-    ND const lstring& getName() const { return name_; }
+    ND const lstring& getName() const { return name_->name_; }
 
     // Get function code_.
     ND Lil_value_Ptr getCode() const { return code_; }
@@ -712,26 +1439,70 @@ public:
     void setCode(Lil_value_Ptr val) {
         assert(val!=nullptr);
         code_ = lil_clone_value(val);
+        parsedCode_.reset();
+        bytecode_.reset();
         sysInfo_->numProcs_++;
         if (code_->getSize() > sysInfo_->maxProcSize_) {
             sysInfo_->maxProcSize_ = code_->getSize();
         }
     }
 
+    // Get parsed code_ (can be nullptr).
+    ND const Lil_parsedCode_Ptr& getParsedCode() const { return parsedCode_; }
+    void setParsedCode(const Lil_parsedCode_Ptr& v) { parsedCode_ = v; }
+
+    // Get compiled code_ (can be nullptr).
+    ND const Lil_bytecode_Ptr& getBytecode() const { return bytecode_; }
+    void setBytecode(const Lil_bytecode_Ptr& v) { bytecode_ = v; }
+
     // Get list of arguments to function.
     ND Lil_list_Ptr getArgnames() const { return argNames_; }
     void setArgnames(Lil_list_Ptr v) { argNames_ = v; }
 
-    // Get function pointer.
-    ND lil_func_proc_t getProc() const { return proc_; }
-    // Set function pointer.
+    // Get function object (nullptr for commands from lil_register_fn()).
+    ND const lil_func_proc_t& getProc() const { return proc_; }
+    // Set function object.
     void setProc(lil_func_proc_t p) {
-        proc_ = p;
+        proc_  = std::move(p);
+        fn_    = nullptr;
+        fnCtx_ = nullptr;
         sysInfo_->numCommands_++;
     }
+    // Set binary command to the one of other.
+    void setProcOf(const Lil_func& other) {
+        proc_  = other.proc_;
+        fn_    = other.fn_;
+        fnCtx_ = other.fnCtx_;
+        sysInfo_->numCommands_++;
+    }
+    // Set function pointer and its context.
+    void setFn(lil_cmd_fn_t fn, void* ctx) {
+        assert(fn!=nullptr);
+        proc_  = nullptr;
+        fn_    = fn;
+        fnCtx_ = ctx;
+        sysInfo_->numCommands_++;
+    }
+    // Is it a binary command.
+    ND bool isProc() const { return fn_ != nullptr || proc_ != nullptr; }
+    // Run binary command.
+    Lil_value_Ptr callProc(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr* argv) const {
+        return fn_ ? fn_(fnCtx_, lil, argc, argv) : proc_(lil, argc, argv);
+    }
     bool serialize(SerializationFlags &flags);
 };
 
+// Get builtin commands by Lil_builtinIndex(), made from lilstd the first time.  They are shared by all the interps of
+// all threads so they are never changed. #optimization
+const std::vector<Lil_func_Ptr>& Lil_getBuiltins(LilInterp_Ptr lil);
+
+// Position in code being parsed, code isn't owned and must outlive the cursor. #optimization
+struct Lil_parseCursor { // #class
+    lcstrp  code_    = nullptr; // Code being parsed (don't own).
+    INT     head_    = 0; // Position in code_.
+    INT     codeLen_ = 0; // Length of code_.
+};
+
 struct LilInterp { // #class
     static const INT NUM_CALLBACKS = 9;
 
@@ -739,23 +1510,34 @@ struct LilInterp { // #class
 private:
     lstring         err_msg_; // Error message.
 
-    // NOTE: A Lil_func_Ptr and now exists in both cmdMap_ and sysCmdMap_.
-    using Cmds_HashTable = std::unordered_map<lstring,Lil_func_Ptr>;
-    Cmds_HashTable cmdMap_;    // Hashmap of "commands".
-    Cmds_HashTable sysCmdMap_; // Hashmap of initial or system "commands".
+    // Symbols of names, shared with child interps.  Before everything naming things by symbols so it is freed last.
+    std::shared_ptr<Lil_symbolTable> symbols_;
+
+    using Cmds_HashTable = Lil_hashMap<Lil_sym,Lil_func_Ptr,Lil_symHash>;
+    Cmds_HashTable cmdMap_;    // Hashmap of "commands", builtin commands are only here when renamed.
+    // Builtin commands aren't put in cmdMap_, they are looked up by Lil_symbol::builtin_ in this table shared by all
+    // interps, so a new interp has nothing to fill in.  #optimization
+    const std::vector<Lil_func_Ptr>* builtinCmds_ = nullptr;
+    std::bitset<LIL_MAX_BUILTINS>    builtinHidden_; // Builtins not named by their name here (deleted, renamed or redefined).
+    std::bitset<LIL_MAX_BUILTINS>    builtinErased_; // Builtins redefined, find_sys_cmd() doesn't give these.
+    INT            cmdEpoch_ = 0; // Changes whenever cmdMap_ does, see Lil_cmdSite. #optimization
+    // New command table epoch.
+    void changeCmdEpoch() { cmdEpoch_ = Lil_newCmdEpoch(); sysInfo_->numCmdTableChanges_++; }
+    Lil_cmdSite    setSite_;      // "set" for $name.
 
     lstring dollarPrefix_; // own memory
 
-    lstring code_; /* need save on parse */ // Waste some space owning, but simplify conception.
-    INT     head_     = 0; // Position in code_ (need save on parse)
-    INT     codeLen_  = 0; // Length of code_  (need save on parse)
-    lcstrp  rootCode_ = nullptr; // The original code_
+    Lil_parseCursor              cursor_;  // Code being parsed now.
+    std::vector<Lil_parseCursor> cursors_; // Code of outer parses, restored by popCode().
+    lcstrp                       rootCode_ = nullptr; // The original code_
 
     bool    ignoreEOL_ = false; // Do we ignore EOL during parsing.
 
     Lil_callframe_Ptr rootEnv_ = nullptr; // Root/global callframe.
     Lil_callframe_Ptr downEnv_ = nullptr; // Another callframe for use with "upeval".
     Lil_callframe_Ptr env_     = nullptr; // Current callframe.
+    std::vector<Lil_callframe_Ptr> freeEnvs_; // Retired callframes, reused by lil_push_env(). #optimization
+    static constexpr size_t FREE_ENVS_MAX = 64; // #magic Enough for the call depth of most scripts.
 
     Lil_value_Ptr       empty_                   = nullptr; // A "empty" Lil_value. (own memory)
     std::vector<lil_callback_proc_t> callback_{NUM_CALLBACKS}; // index LIL_CALLBACK_*
@@ -768,15 +1550,17 @@ private:
 
     INT       parse_depth_ = 0; // Current parse depth.
 
+    // Parsed code by code text, indexed by ignoreEOL_ at parse time. #optimization
+    using Parse_Cache = std::unordered_map<lstring,Lil_parsedCode_Ptr,Lil_strHash,std::equal_to<>>;
+    Parse_Cache parseCache_[2];
+    // Compiled expressions by expression text. #optimization
+    using Expr_Cache = std::unordered_map<lstring,Lil_exprProgram_Ptr,Lil_strHash,std::equal_to<>>;
+    Expr_Cache exprCache_;
+
     // Set root/global "callframe".
     void setRootEnv(Lil_callframe_Ptr v) { rootEnv_ = v; }
     // Set "empty" value_.
     void setEmptyVal(Lil_value_Ptr v) { empty_ = v; }
-    void defineSystemCmds() { sysCmdMap_ = cmdMap_; }
-    // Set interp text.
-    void setCode(lcstrp  ptr) { code_ = ptr; }
-    // Set current offset in code_.
-    ND INT& setHead() { return head_; }
     // Set "catcher".
     void setCatcher(lcstrp  ptr) { catcher_ = ptr; }
     // Set "catcher" to empty.
@@ -798,6 +1582,9 @@ public:
             lil_free_env(this->getEnv());
             this->setEnv(next);
         }
+        for (auto env : freeEnvs_) {
+            lil_free_env(env);
+        }
         // When top interpreter dies reset configuration options for next time.
         // Remember this is per-thread.
         if (parentInterp_==nullptr) Lil_getSysInfo(true);
@@ -805,75 +1592,231 @@ public:
 
     bool serialize(SerializationFlags &flags);
 
+    // Get symbols of names.
+    ND Lil_symbolTable& getSymbols() const { return *symbols_; }
+
     // Size commands hashtable.  #optimization
     void cmdmap_reserve(Cmds_HashTable::size_type sz) { cmdMap_.reserve(sz); }
 
+    // Get a retired callframe as new callframe of parent or nullptr if there are none.
+    ND Lil_callframe_Ptr reuseEnv(Lil_callframe_Ptr parent) {
+        if (freeEnvs_.empty()) { return nullptr; }
+        Lil_callframe_Ptr env = freeEnvs_.back();
+        freeEnvs_.pop_back();
+        env->reuse(parent);
+        sysInfo_->numEnvReuses_++;
+        return env;
+    }
+    // Done with callframe env, keep it for reuseEnv() unless there are enough already.
+    void retireEnv(Lil_callframe_Ptr env) {
+        assert(env!=nullptr);
+        if (freeEnvs_.size() >= FREE_ENVS_MAX) {
+            lil_free_env(env);
+            return;
+        }
+        env->retire();
+        freeEnvs_.push_back(env);
+    }
+
+    // Get builtin index of the builtin command named sym here or -1.
+    ND INT builtinIndex(Lil_sym sym) const {
+        if (!sym || sym->builtin_ < 0) { return -1; }
+        auto i = CAST(size_t)sym->builtin_;
+        return (builtinHidden_[i] || !(*builtinCmds_)[i]) ? -1 : sym->builtin_;
+    }
+    // Is cmdD one of the shared builtin commands.
+    ND bool isBuiltinCmd(const Lil_func_Ptr& cmdD) const {
+        INT i = cmdD->name_->builtin_;
+        return i >= 0 && (*builtinCmds_)[CAST(size_t)i] == cmdD;
+    }
+    // Get cmdD to change, a copy of it if it is a shared builtin command.
+    ND Lil_func_Ptr ownCmd(const Lil_func_Ptr& cmdD) {
+        assert(cmdD!=nullptr);
+        if (!isBuiltinCmd(cmdD)) { return cmdD; }
+        auto copy = std::make_shared<Lil_func>(this, cmdD->getName().c_str());
+        copy->setProcOf(*cmdD);
+        return copy;
+    }
     // Does command exists.
     ND bool cmdExists(lcstrp  target)  {
         assert(target!=nullptr);
-        return cmdMap_.contains(target);
+        Lil_sym sym = symbols_->find(target);
+        return sym && (builtinIndex(sym) >= 0 || cmdMap_.contains(sym));
     }
-    // Add command.
+    // Get system command that still has its builtin function or nullptr.
+    ND Lil_func_Ptr find_sys_cmd(lcstrp  name) {
+        assert(name!=nullptr);
+        Lil_sym sym = symbols_->find(name);
+        if (!sym || sym->builtin_ < 0 || builtinErased_[CAST(size_t)sym->builtin_]) { return nullptr; }
+        return (*builtinCmds_)[CAST(size_t)sym->builtin_];
+    }
+    // Add command, it replaces any builtin of that name.
     void hashmap_addCmd(lcstrp  name, Lil_func_Ptr func) {
         assert(name!=nullptr); assert(func!=nullptr);
-        cmdMap_[name] = std::shared_ptr<Lil_func>(func);
+        Lil_symRef sym = symbols_->intern(name);
+        assert(func->name_ == sym);
+        if (sym->builtin_ >= 0) { builtinHidden_.set(CAST(size_t)sym->builtin_); }
+        cmdMap_[sym] = std::shared_ptr<Lil_func>(func);
+        changeCmdEpoch();
     }
     // Remove command.
     void hashmap_removeCmd(lcstrp  name) {
         assert(name!=nullptr);
-        auto it = cmdMap_.find(name); if (it != cmdMap_.end()) cmdMap_.erase(it);
+        Lil_sym sym = symbols_->find(name);
+        INT     i   = builtinIndex(sym);
+        if (i >= 0) {
+            builtinHidden_.set(CAST(size_t)i);
+        } else if (sym) {
+            cmdMap_.erase(sym);
+        }
+        changeCmdEpoch();
     }
     void duplicate_cmds(LilInterp_Ptr parent) {
         assert(parent!=nullptr);
-        cmdMap_    = parent->cmdMap_;
-        sysCmdMap_ = parent->sysCmdMap_;
+        cmdMap_        = parent->cmdMap_;
+        builtinHidden_ = parent->builtinHidden_;
+        builtinErased_ = parent->builtinErased_;
+        changeCmdEpoch();
     }
+    // Only the builtin commands.
     void jail_cmds(LilInterp_Ptr parent) {
         assert(parent!=nullptr);
-        cmdMap_    = parent->sysCmdMap_;
-        sysCmdMap_ = parent->sysCmdMap_;
+        cmdMap_.clear();
+        builtinHidden_.reset();
+        builtinErased_.reset();
+        changeCmdEpoch();
     }
+    // Get command table epoch, it changes whenever a command is added, removed or renamed.
+    ND INT getCmdEpoch() const { return cmdEpoch_; }
+    // Get command by name using what was found at site while the command table epoch is the same.
+    ND const Lil_func_Ptr& find_cmd(lstring_view name, Lil_cmdSite& site) {
+        if (site.epoch_ == cmdEpoch_) {
+            sysInfo_->numCmdSiteHits_++;
+        } else {
+            sysInfo_->numCmdSiteMisses_++;
+            Lil_sym sym = symbols_->find(name);
+            INT     i   = builtinIndex(sym);
+            if (i >= 0) {
+                site.cmd_ = (*builtinCmds_)[CAST(size_t)i];
+            } else {
+                auto it   = sym ? cmdMap_.find(sym) : cmdMap_.end();
+                site.cmd_ = (it == cmdMap_.end()) ? nullptr : it->second;
+            }
+            site.epoch_ = cmdEpoch_;
+        }
+        return site.cmd_;
+    }
+    // Call site of "set" for $name.
+    ND Lil_cmdSite& getSetSite() { return setSite_; }
     void applyToFuncs(std::function<void(const lstring&, const Lil_func_Ptr)> func) {
+        for (size_t i = 0; i < builtinCmds_->size(); i++) {
+            auto& cmdD = (*builtinCmds_)[i];
+            if (cmdD && !builtinHidden_[i]) { func(cmdD->getName(), cmdD); }
+        }
         for( const auto& n : cmdMap_ ) {
-            func(n.first, n.second);
+            func(n.first->name_, n.second);
         }
     }
     void delete_cmds(Lil_func_Ptr cmdD) {
         assert(cmdD!=nullptr);
+        if (isBuiltinCmd(cmdD)) {
+            builtinHidden_.set(CAST(size_t)cmdD->name_->builtin_);
+            changeCmdEpoch();
+            return;
+        }
         for (auto it = cmdMap_.begin(); it != cmdMap_.end(); ++it) {
             if (it->second == cmdD) {
                 cmdMap_.erase(it);
+                changeCmdEpoch();
                 return;
             }
         }
     }
 
     // Get code_ length.
-    ND INT getCodeLen() const { return codeLen_; }
+    ND INT getCodeLen() const { return cursor_.codeLen_; }
 
     // Get original code_.
     ND lcstrp  getRootCode() const { return rootCode_; }
     // Set original code_.
     ND lcstrp & setRootCode() { return rootCode_; }
 
-    // Set interp text.
-    void setCode(lcstrp  codeD, INT codelen, INT headPos = 0) { // codeD could be nullptr.
-        setCode( codeD );
-        codeLen_ = codelen;
-        setHead()    = headPos;
+    // Start parsing code, the outer code is saved without copying.  codeD must outlive the matching popCode().
+    void pushCode(lcstrp  codeD, INT codelen) {
+        assert(codeD!=nullptr);
+        cursors_.push_back(cursor_);
+        cursor_ = Lil_parseCursor{codeD, 0, codelen};
+    }
+    // Go back to the code being parsed when getCodeDepth() was depth.
+    void popCode(size_t depth) {
+        while (cursors_.size() > depth) {
+            cursor_ = cursors_.back();
+            cursors_.pop_back();
+        }
     }
+    // Number of outer codes saved by pushCode().
+    ND size_t getCodeDepth() const { return cursors_.size(); }
+    // Are we parsing any code?
+    ND bool inCode() const { return cursor_.code_ != nullptr; }
     // Get code_.
-    ND const lstring& getCodeObj() const { return code_; }
+    ND lcstrp  getCode() const { return cursor_.code_; }
     // Get current character.
-    ND lchar getHeadChar() const { return code_[head_]; }
-    // Get (current + i) character.
-    ND lchar getHeadCharPlus(INT i) const { return code_[head_ + i]; }
+    ND lchar getHeadChar() const { return getHeadCharPlus(0); }
+    // Get (current + i) character, past end of code is '\0'.
+    ND lchar getHeadCharPlus(INT i) const {
+        return (cursor_.head_ + i < cursor_.codeLen_) ? cursor_.code_[cursor_.head_ + i] : LC('\0');
+    }
     // Get current character and advance 1 character.
-    ND lchar getHeadCharAndAdvance() { return code_[head_++]; }
+    ND lchar getHeadCharAndAdvance() { lchar ch = getHeadChar(); cursor_.head_++; return ch; }
     // Advance val characters.
-    void incrHead(INT v) { head_ += v; }
+    void incrHead(INT v) { cursor_.head_ += v; }
     // Get current offset in code_.
-    ND INT getHead() const { return head_; }
+    ND INT getHead() const { return cursor_.head_; }
+    // Move to offset in code_.
+    void moveHead(INT pos) { cursor_.head_ = pos; }
+
+    // Find parsed code in cache or nullptr.
+    ND Lil_parsedCode_Ptr findParsedCode(lstring_view codeD, bool ignoreEol) {
+        auto& cache = parseCache_[ignoreEol ? 1 : 0];
+        auto it = cache.find(codeD);
+        if (it == cache.end()) {
+            sysInfo_->numParseCacheMisses_++;
+            return nullptr;
+        }
+        sysInfo_->numParseCacheHits_++;
+        return it->second;
+    }
+    // Add parsed code to cache, if it's too big don't bother.
+    void addParsedCode(const Lil_parsedCode_Ptr& parsed) {
+        assert(parsed!=nullptr);
+        if (parsed->codeLen_ > sysInfo_->parseCacheMaxCodeLen_) { return; }
+        auto& cache = parseCache_[parsed->ignoreEol_ ? 1 : 0];
+        if (std::ssize(cache) >= sysInfo_->parseCacheMaxSize_) {
+            if (!sysInfo_->parseCacheMaxSize_) { return; }
+            cache.clear(); // Simplest eviction, whatever is still hot gets parsed again.
+        }
+        cache.emplace(parsed->code_, parsed);
+    }
+
+    // Find compiled expression in cache or nullptr.
+    ND Lil_exprProgram_Ptr findExprProgram(lstring_view codeD) {
+        auto it = exprCache_.find(codeD);
+        if (it == exprCache_.end()) {
+            sysInfo_->numExprCacheMisses_++;
+            return nullptr;
+        }
+        sysInfo_->numExprCacheHits_++;
+        return it->second;
+    }
+    // Add compiled expression to cache.
+    void addExprProgram(lstring_view codeD, const Lil_exprProgram_Ptr& prog) {
+        assert(prog!=nullptr);
+        if (std::ssize(exprCache_) >= sysInfo_->exprCacheMaxSize_) {
+            if (!sysInfo_->exprCacheMaxSize_) { return; }
+            exprCache_.clear(); // Simplest eviction, same as parseCache_.
+        }
+        exprCache_.emplace(lstring(codeD), prog);
+    }
 
     // Get callback function pointer.
     ND lil_callback_proc_t getCallback(LIL_CALLBACK_IDS index) { return callback_[index]; }
@@ -896,7 +1839,9 @@ public:
     ND bool& setIgnoreEol() { return ignoreEOL_; }
 
     // Get number of commands.
-    ND INT getNumCmds() const { return std::ssize(sysCmdMap_); }
+    ND INT getNumCmds() const {
+        return std::count_if(builtinCmds_->begin(), builtinCmds_->end(), [](const Lil_func_Ptr& f) { return f != nullptr; });
+    }
 
     // Get catcher if inside "catch" or nullptr if not.
     ND const lstring & getCatcher() const { return catcher_; }
@@ -980,12 +1925,13 @@ public:
     }
     ND const lstring& getErrMsg() const { return err_msg_; }
 
-    ND Lil_func_Ptr find_cmd(lcstrp  name);
+    ND Lil_func_Ptr find_cmd(lstring_view name);
     ND Lil_func_Ptr add_func(lcstrp  name);
     void del_func(Lil_func_Ptr cmdD);
 
         [[maybe_unused]] ND Lil_value_Ptr rename_func(INT argc, Lil_value_Ptr* argv);
     ND bool registerFunc(lcstrp  name, lil_func_proc_t proc);
+    ND bool registerFunc(lcstrp  name, lil_cmd_fn_t fn, void* ctx);
 
     // Used to filter command that can be added.
     using cmdFilterType = std::function<bool(lcstrp  name, lil_func_proc_t proc)>;
@@ -1057,16 +2003,34 @@ Lil_func_Ptr _add_func(LilInterp_Ptr lil, lcstrp name);
 void         _del_func(LilInterp_Ptr lil, Lil_func_Ptr cmd);
 Lil_var_Ptr  _lil_find_local_var(LilInterp_Ptr lil, Lil_callframe_Ptr env, lcstrp name);
 Lil_var_Ptr  _lil_find_var(LilInterp_Ptr lil, Lil_callframe_Ptr env, lcstrp name);
+Lil_listRep_Ptr _value_list(LilInterp_Ptr lil, Lil_value_Ptr val);
+Lil_value_Ptr   _list_to_cached_value(LilInterp_Ptr lil, Lil_list_Ptr list);
+Lil_list_Ptr    _own_var_list(LilInterp_Ptr lil, lcstrp name, LIL_VAR_TYPE access, Lil_value_Ptr& val);
+Lil_dictRep_Ptr _value_dict(LilInterp_Ptr lil, Lil_value_Ptr val);
+Lil_value_Ptr   _dict_to_value(LilInterp_Ptr lil, Lil_dictRep_Ptr dict);
+Lil_dict*       _own_var_dict(LilInterp_Ptr lil, lcstrp name, LIL_VAR_TYPE access, Lil_value_Ptr& val);
+bool            _match_counted_cond(lstring_view cond, Lil_countedLoop& loop);
+bool            _match_counted_step(lstring_view step, Lil_countedLoop& loop);
+INT             _counted_test(LilInterp_Ptr lil, const Lil_countedLoop& loop, Lil_func_Ptr setFunc);
+bool            _counted_step(LilInterp_Ptr lil, const Lil_countedLoop& loop);
 
 struct CommandAdaptor;
 
 struct Module { // #class
     lstring     name_;
     INT         version_[2] = {0,0};
-    using element = std::tuple<lstring,lil_func_proc_t,CommandAdaptor*>;
+    using element = std::tuple<lstring,lil_cmd_fn_t,CommandAdaptor*>;
     std::vector<element> commands_;
-    void add(lstring_view name, lil_func_proc_t func, CommandAdaptor* obj) {
-        commands_.push_back(element{name, func, obj});
+    // Add command obj, it must outlive the interps it is registered in.
+    template<typename CMD>
+    void add(lstring_view name, CMD* obj) {
+        commands_.push_back(element{name, &callCmd<CMD>, obj});
+    }
+    // Run command ctx (a CMD as CommandAdaptor*), CMD::operator() is called directly instead of through the vtable
+    // and std::function. #optimization
+    template<typename CMD>
+    static Lil_value_Ptr callCmd(void* ctx, LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr* argv) {
+        return static_cast<CMD*>(static_cast<CommandAdaptor*>(ctx))->CMD::operator()(lil, argc, argv);
     }
 };
 
@@ -36,6 +36,7 @@
 #include <fstream>
 #include <string>
 #include <filesystem>
+#include <chrono>
 
 #include "lil.h"
 #include "lil_inter.h"
@@ -359,6 +360,210 @@ static int unittest_eval(lcstrp name, lcstrp input) { // #UNITTEST
     return exit_code;
 }
 
+#ifndef LIL_NO_UNITTEST
+// Throws away output of unittest_bench().
+static LILCALLBACK void lil_write_callback_for_bench(LilInterp_Ptr lil, lcstrp msg) { // #UNITTEST
+    (void)lil; (void)msg;
+}
+
+// Time looking up every command name numRuns*1000 times in MAP, by name like Lil_symbolTable does then by symbol like
+// cmdMap_ does. #UNITTEST
+template<template<typename...> class MAP>
+static void bench_lookups(lcstrp mapName, const std::vector<lstring>& names, int numRuns) {
+    MAP<lstring_view,Lil_sym,Lil_strHash,std::equal_to<>> byName;
+    MAP<Lil_sym,size_t,Lil_symHash,std::equal_to<Lil_sym>> bySym;
+    Lil_symbolTable         symbols;
+    std::vector<Lil_symRef> refs; // Keep the symbols.
+    for (const auto& name : names) {
+        Lil_sym sym = refs.emplace_back(symbols.intern(name));
+        byName.emplace(sym->name_, sym);
+        bySym.emplace(sym, 1);
+    }
+    size_t found = 0;
+    auto   start = std::chrono::steady_clock::now();
+    for (int run = 0; run < numRuns * 1000; run++) {
+        for (const auto& name : names) {
+            auto it = byName.find(lstring_view(name));
+            if (it != byName.end()) { found += bySym.find(it->second)->second; }
+        }
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    std::cout << "bench: lookups " << mapName << " found " << found << " seconds " << secs.count() << std::endl;
+}
+
+// Command that does nothing, with help text about as long as a builtin's. #UNITTEST
+struct bench_nop_type : CommandAdaptor { // #cmd
+    bench_nop_type() { help_ = lstring(400, ' '); tags_ = "bench"; } // #magic
+    Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr* argv) override {
+        (void)lil; (void)argc; (void)argv;
+        return nullptr;
+    }
+};
+
+// Time calling a command numRuns*10000 times, the way builtins used to be called (their std::function copied by
+// Lil_func::getProc() on each call), through std::function and through the lil_register_fn() function pointer.
+// #UNITTEST
+static void bench_dispatch(int numRuns) {
+    bench_nop_type nop;
+    LilInterp_Ptr  lil = lil_new();
+    lil_register(lil, "nop-std", nop); // As all builtins were registered.
+    lil_register_fn(lil, "nop-fn", &Module::callCmd<bench_nop_type>, static_cast<CommandAdaptor*>(&nop));
+    Lil_func_Ptr stdCmd = lil->find_cmd("nop-std");
+    Lil_func_Ptr fnCmd  = lil->find_cmd("nop-fn");
+    auto timeCalls = [numRuns](lcstrp how, auto&& call) {
+        size_t numNull = 0;
+        auto   start   = std::chrono::steady_clock::now();
+        for (int i = 0; i < numRuns * 10000; i++) {
+            if (call() == nullptr) { numNull++; }
+        }
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        std::cout << "bench: dispatch " << how << " calls " << numNull << " seconds " << secs.count() << std::endl;
+    };
+    timeCalls("std::function copied per call", [&]() { lil_func_proc_t proc = stdCmd->getProc(); return proc(lil, 0, nullptr); });
+    timeCalls("std::function", [&]() { return stdCmd->callProc(lil, 0, nullptr); });
+    timeCalls("function pointer", [&]() { return fnCmd->callProc(lil, 0, nullptr); });
+    lil_free(lil);
+}
+
+// Time making and freeing numRuns*1000 interps, as "jaileval" does, then finding every builtin in one. #UNITTEST
+static void bench_interps(const std::vector<lstring>& names, int numRuns) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numRuns * 1000; i++) {
+        lil_free(lil_new());
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    std::cout << "bench: interps made " << numRuns * 1000 << " seconds " << secs.count() << std::endl;
+
+    LilInterp_Ptr lil   = lil_new();
+    size_t        found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int run = 0; run < numRuns * 1000; run++) {
+        for (const auto& name : names) {
+            if (lil->find_cmd(name)) { found++; }
+        }
+    }
+    secs = std::chrono::steady_clock::now() - start;
+    std::cout << "bench: builtins found " << found << " seconds " << secs.count() << std::endl;
+    lil_free(lil);
+}
+
+// Time numRuns*10 calls of a func that returns a value from 50 deep recursion, run as parsed code and as bytecode.
+// #UNITTEST
+static void bench_return(int numRuns) {
+    for (INT funcBytecode : {0, 1}) {
+        LilInterp_Ptr lil = lil_new();
+        lil->sysInfo_->funcBytecode_ = funcBytecode;
+        lil_free_value(lil_parse(lil, "func down {n} { if {$n} { return [down [expr $n - 1]] } ; return done }", 0, 1));
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numRuns * 10; i++) {
+            lil_free_value(lil_parse(lil, "down 50", 0, 1));
+        }
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        std::cout << "bench: return funcBytecode_ " << funcBytecode << " calls " << numRuns * 10 * 51 << " seconds "
+                  << secs.count() << std::endl;
+        lil_free(lil);
+    }
+}
+
+// Time numRuns*10 counted for loops of 1000 iterations and the same loops with a step that isn't counted, run as
+// parsed code and as bytecode. #UNITTEST
+static void bench_loops(int numRuns) {
+    for (INT funcBytecode : {0, 1}) {
+        LilInterp_Ptr lil = lil_new();
+        lil->sysInfo_->funcBytecode_ = funcBytecode;
+        lil_free_value(lil_parse(lil, "func counted {n} { for {set i 0} {$i < $n} {inc i} { set s $i } }\n"
+                                      "func generic {n} { for {set i 0} {$i < $n} {set i [expr $i + 1]} { set s $i } }",
+                                 0, 1));
+        for (lcstrp loop : {"counted", "generic"}) {
+            lstring code  = lstring(loop) + " 1000";
+            auto    start = std::chrono::steady_clock::now();
+            for (int i = 0; i < numRuns * 10; i++) {
+                lil_free_value(lil_parse(lil, code.c_str(), 0, 1));
+            }
+            std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+            std::cout << "bench: " << loop << " loop funcBytecode_ " << funcBytecode << " iterations "
+                      << numRuns * 10 * 1000 << " seconds " << secs.count() << std::endl;
+        }
+        lil_free(lil);
+    }
+}
+
+// Time numRuns splits of a 1MB text into a list (the parser's scanning of spaces, bare words, braces and quotes)
+// and numRuns conversions of that list back into text (escaping its items). #UNITTEST
+static void bench_scan(int numRuns) {
+    lstring text;
+    for (int i = 0; text.length() < 0x100000; i++) { // #magic
+        text += "plain_word_" + std::to_string(i) + " {braced item with spaces and {nested} ones} "
+                "\"quoted text that goes on for a while\" # not a comment in a list\n";
+    }
+    LilInterp_Ptr lil   = lil_new();
+    Lil_value_Ptr value = lil_alloc_string(lil, text.c_str());
+    Lil_list_Ptr  list  = nullptr;
+    auto          start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numRuns; i++) {
+        if (list) { lil_free_list(list); }
+        list = lil_subst_to_list(lil, value);
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    std::cout << "bench: scan text to list items " << lil_list_size(list) << " seconds " << secs.count() << std::endl;
+    size_t length = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numRuns; i++) {
+        Lil_value_Ptr listText = lil_list_to_value(lil, list, true);
+        length += CAST(size_t)listText->getValueLen();
+        lil_free_value(listText);
+    }
+    secs = std::chrono::steady_clock::now() - start;
+    std::cout << "bench: scan list to text length " << length << " seconds " << secs.count() << std::endl;
+    lil_free_list(list);
+    lil_free_value(value);
+    lil_free(lil);
+}
+
+// Time running all the unittest scripts numRuns times, without the logging configure_interpreter() turns on.  Build
+// with and without LIL_STD_HASHMAPS to compare the hashtables in the interpreter, the lookups are compared directly.
+// #UNITTEST
+static int unittest_bench(int numRuns) {
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < numRuns; run++) {
+        for (const auto& test : ut) {
+            LilInterp_Ptr lil = lil_new();
+            lil_callback(lil, LIL_CALLBACK_WRITE, (lil_callback_proc_t) lil_write_callback_for_bench);
+            lil_register(lil, "writechar", fnc_writechar);
+            lil_register(lil, "system", fnc_system);
+            lil_register(lil, "canread", fnc_canRead);
+            lil_register(lil, "readline", fnc_readline);
+
+            Lil_value_Ptr code = lil_alloc_string(lil, test.input);
+            lil_set_var(lil, "__lilmain:code__", code, LIL_SETVAR_GLOBAL);
+            lil_free_value(lil_parse(lil, "eval ${__lilmain:code__}\n", 0, 1));
+            lil_free_value(code);
+            lil_free(lil);
+        }
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+#ifdef LIL_STD_HASHMAPS
+    lcstrp mapName = "std::unordered_map";
+#else
+    lcstrp mapName = "EjUtil::FlatMap";
+#endif
+    std::cout << "bench: " << mapName << " runs " << numRuns << " seconds " << secs.count() << std::endl;
+
+    std::vector<lstring> names;
+    LilInterp_Ptr lil = lil_new();
+    lil->applyToFuncs([&names](const lstring& name, const Lil_func_Ptr) { names.push_back(name); });
+    lil_free(lil);
+    bench_lookups<std::unordered_map>("std::unordered_map", names, numRuns);
+    bench_lookups<EjUtil::FlatMap>("EjUtil::FlatMap", names, numRuns);
+    bench_dispatch(numRuns);
+    bench_interps(names, numRuns);
+    bench_return(numRuns);
+    bench_loops(numRuns);
+    bench_scan(numRuns);
+    return 0;
+}
+#endif
+
 NS_END(LILNS)
 
 int main(int argc, const char* argv[]) {
@@ -388,6 +593,9 @@ int main(int argc, const char* argv[]) {
         std::cout << "numErrors: " << numErrors << "\n";
         return numErrors;
     }
+    if (argv[1] && strcmp(argv[1],"bench")==0) { // #UNITTEST
+        return unittest_bench((argc > 2) ? std::max(1, atoi(argv[2])) : 100);
+    }
 #endif
     try {
         if (argc < 2) { return repl(); } // Plan integrative mode.
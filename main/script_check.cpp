@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2022 Earl Johnson
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Earl Johnson https://github.com/earl-sudo/lilcxx 2022
+ */
+
+// Run unittest scripts and compare their output with orig_output/<script>.lil.result1, each script runs with every
+// cache and compiler on and again with each of them off (see g_modes).  Then random expressions are run with compiled
+// expressions and the text way and their output compared, and the settings of the caches checked.  Run from
+// unittest_scripts. #UNITTEST
+//
+//   script_check [--seeds <num>] <script> ...
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lil.h"
+#include "lil_inter.h"
+
+using namespace LILNS;
+
+static std::string g_output; // Output of the script running.
+
+static LILCALLBACK void lil_write_callback_for_check([[maybe_unused]] LilInterp_Ptr lil, lcstrp msg) { // #UNITTEST
+    g_output.append(msg);
+}
+
+static LILCALLBACK Lil_value_Ptr fnc_writechar([[maybe_unused]] LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) {
+    if (!argc) { return nullptr; } // #argErr
+    bool inError = false;
+    g_output.append(1, CAST(lchar)lil_to_integer(argv[0], inError));
+    return nullptr;
+}
+
+static std::string read_file(const std::string& fileName) {
+    std::ifstream     in(fileName, std::ios::binary);
+    std::stringstream strm;
+    strm << in.rdbuf();
+    return strm.str();
+}
+
+// Way to run scripts, with setting off_ turned off (nullptr for all of them on).
+struct CheckMode { // #class #UNITTEST
+    const char*      name_;
+    INT SysSettings::* off_;
+};
+static const CheckMode g_modes[] = {
+    {"",                    nullptr},
+    {" (no expr cache)",    &SysSettings::exprCacheMaxSize_},
+    {" (no bytecode)",      &SysSettings::funcBytecode_},
+    {" (no parse cache)",   &SysSettings::parseCacheMaxSize_},
+    {" (no counted loops)", &SysSettings::countedLoops_},
+};
+static const CheckMode& g_textExprs = g_modes[1];
+
+// Output of running script in a new interp the way mode says.
+static std::string run_script(const std::string& script, const CheckMode& mode) { // #UNITTEST
+    SysInfo*    sysInfo  = Lil_getSysInfo();
+    SysSettings settings = *sysInfo;
+    if (mode.off_) { sysInfo->*mode.off_ = 0; }
+    g_output.clear();
+    LilInterp_Ptr lil = lil_new();
+    lil_callback(lil, LIL_CALLBACK_WRITE, (lil_callback_proc_t) lil_write_callback_for_check);
+    lil_register(lil, "writechar", fnc_writechar);
+    Lil_value_Ptr result = lil_parse(lil, script.c_str(), 0, 1);
+    lil_free_value(result);
+    lil_free(lil);
+    CAST(SysSettings&)*sysInfo = settings;
+    return g_output;
+}
+
+// Print lines that differ between out and expected, returns number of differences.
+static int diff_lines(const std::string& out, const std::string& expected) { // #UNITTEST
+    int numDiffs = 0;
+    std::stringstream outStrm(out), expectedStrm(expected);
+    std::string outLine, expectedLine;
+    for (;;) {
+        bool gotOut      = CAST(bool)std::getline(outStrm, outLine);
+        bool gotExpected = CAST(bool)std::getline(expectedStrm, expectedLine);
+        if (!gotOut && !gotExpected) { break; }
+        if (!gotOut || !gotExpected || outLine != expectedLine) {
+            std::cout << "DIFF_:" << (gotOut ? outLine : "----------------") << "|"
+                      << (gotExpected ? expectedLine : "----------------") << "|" << std::endl;
+            numDiffs++;
+        }
+    }
+    return numDiffs;
+}
+
+// Run unittest script name every way, returns number of differences.
+static int check_script(const std::string& name) { // #UNITTEST
+    std::string script   = read_file(name + ".lil");
+    std::string expected = read_file("orig_output/" + name + ".lil.result1");
+    int numDiffs = 0;
+    for (auto& mode : g_modes) {
+        int num = diff_lines(run_script(script, mode), expected);
+        std::cout << "TEST: " << name << mode.name_ << " numFail " << num << (num ? " ****" : "") << std::endl;
+        numDiffs += num;
+    }
+    return numDiffs;
+}
+
+// Settings stay set for an interp when another interp is freed, returns number of differences.
+static int check_settings_kept() { // #UNITTEST
+    SysInfo*    sysInfo  = Lil_getSysInfo();
+    SysSettings settings = *sysInfo;
+    sysInfo->funcBytecode_      = 0;
+    sysInfo->parseCacheMaxSize_ = 0;
+    LilInterp_Ptr lil = lil_new();
+    lil_free(lil_new());
+    int numDiffs = (sysInfo->funcBytecode_ != 0) + (sysInfo->parseCacheMaxSize_ != 0);
+    lil_free(lil);
+    CAST(SysSettings&)*sysInfo = settings;
+    std::cout << "TEST: settings kept numFail " << numDiffs << (numDiffs ? " ****" : "") << std::endl;
+    return numDiffs;
+}
+
+// Output of code run in lil.
+static std::string run_code(LilInterp_Ptr lil, lcstrp code) { // #UNITTEST
+    Lil_value_Ptr result = lil_parse(lil, code, 0, 1);
+    std::string   text   = lil_to_string(result);
+    lil_free_value(result);
+    return text;
+}
+
+// A call site of a redefined func still finds the new func after another interp is freed, returns number of
+// differences.
+static int check_cmd_epochs() { // #UNITTEST
+    LilInterp_Ptr lil = lil_new();
+    run_code(lil, "func foo {} {return one}");
+    int numDiffs = (run_code(lil, "foo") != "one");
+    lil_free(lil_new());
+    run_code(lil, "func foo {} {return two}");
+    numDiffs += (run_code(lil, "foo") != "two");
+    lil_free(lil);
+    std::cout << "TEST: cmd epochs numFail " << numDiffs << (numDiffs ? " ****" : "") << std::endl;
+    return numDiffs;
+}
+
+// Values made by one thread are deleted by another, the one made by the other thread after it has ended.  Returns
+// number of differences.
+static int check_other_thread() { // #UNITTEST
+    LilInterp_Ptr lil    = lil_new();
+    Lil_value_Ptr here   = lil_alloc_string(lil, "here");
+    Lil_list_Ptr  list   = lil_alloc_list(lil);
+    Lil_value_Ptr thread = nullptr;
+    std::thread([&] {
+        lil_free_value(here);
+        thread = lil_alloc_string(lil, "thread");
+        lil_list_append(list, lil_alloc_string(lil, "item"));
+    }).join();
+    lil_free_value(lil_alloc_string(lil, "again")); // Gets memory the other thread gave back.
+    int numDiffs = (lil_to_string(thread) != std::string("thread"));
+    lil_free_value(thread);
+    lil_free_list(list);
+    lil_free(lil);
+    std::cout << "TEST: other thread numFail " << numDiffs << (numDiffs ? " ****" : "") << std::endl;
+    return numDiffs;
+}
+
+// Interp made on one thread runs code on another, one made on a thread that has ended runs code.  Returns number of
+// differences.
+static int check_thread_interps() { // #UNITTEST
+    static const char* codes[][2] = {
+        {"set a 3; set a", "3"}, {"expr 1+2", "3"}, {"list a b", "a b"},
+        {"func sq {x} {return [expr $x * $x]}; sq 4", "16"}, {"sq [set a]", "9"},
+    };
+    LilInterp_Ptr here  = lil_new();
+    LilInterp_Ptr ended = nullptr;
+    int numDiffs = 0;
+    std::thread([&] {
+        ended = lil_new();
+        for (auto& code : codes) { numDiffs += (run_code(here, code[0]) != code[1]); }
+    }).join();
+    for (auto& code : codes) { numDiffs += (run_code(ended, code[0]) != code[1]); }
+    lil_free(here);
+    lil_free(ended);
+    std::cout << "TEST: thread interps numFail " << numDiffs << (numDiffs ? " ****" : "") << std::endl;
+    return numDiffs;
+}
+
+// Generated variable names are freed from the symbol table once nothing is named by them.
+static int check_symbols_freed() { // #UNITTEST
+    LilInterp_Ptr lil = lil_new();
+    run_code(lil, "func gen {n} {for {set i 0} {$i < $n} {inc i} {set x$i $i}; return [set x[expr $n - 1]]}; gen 1");
+    size_t before   = lil->getSymbols().size();
+    int    numDiffs = (run_code(lil, "gen 1000") != "999");
+    numDiffs += (lil->getSymbols().size() != before);
+    lil_free(lil);
+    std::cout << "TEST: symbols freed numFail " << numDiffs << (numDiffs ? " ****" : "") << std::endl;
+    return numDiffs;
+}
+
+// Random expressions with variables in them, compiled the same as text only if the compiler gives up on the right
+// things.  Values include ones that aren't plain numbers and operands like "$a$b", "$a.5" and "1${a}" that only
+// mean something once substituted.
+struct ExprFuzz { // #class #UNITTEST
+    std::mt19937 rand_;
+
+    explicit ExprFuzz(unsigned seed) : rand_(seed) { } // #ctor
+
+    size_t pick(size_t num) { return std::uniform_int_distribution<size_t>(0, num - 1)(rand_); }
+    template<typename T, size_t N>
+    const T& pick(const T (&items)[N]) { return items[pick(N)]; }
+
+    std::string var() { return pick({"a", "b", "c", "d"}); }
+    std::string value() {
+        static const char* values[] = {"0", "1", "2", "3", "7", "12", "-1", "-4", "2.5", "-0.5", "1.0", "x", "", "1 + 1", "007", "-0", "1e3", " 5"};
+        return pick(values);
+    }
+    std::string operand(int depth) {
+        switch (pick(depth > 0 ? 12 : 9)) {
+            case 0:  return pick({"0", "1", "2", "5", "10", "3.25"});
+            case 1:
+            case 2:  return "$" + var();
+            case 3:  return "$" + var() + "$" + var();
+            case 4:  return "$" + var() + ".5";
+            case 5:  return "1${" + var() + "}";
+            case 6:  return "-$" + var();
+            case 7:  return pick({"!", "~", "+"}) + ("$" + var());
+            case 8:  return "$" + var() + pick({"0", "."});
+            default: return "(" + expr(depth - 1) + ")";
+        }
+    }
+    std::string expr(int depth) {
+        static const char* opers[] = {"+", "-", "*", "/", "\\", "%", "<", ">", "<=", ">=", "==", "!=", "&", "|",
+                                      "&&", "||", "<<", ">>"};
+        std::string text = operand(depth);
+        for (size_t num = pick(3); num; num--) {
+            std::string op = pick(opers);
+            // Shift only by small constants, anything else is undefined for both ways.
+            text += pick({" ", ""}) + op + pick({" ", ""}) + ((op == "<<" || op == ">>") ? pick({"0", "1", "3"}) : operand(depth));
+        }
+        return text;
+    }
+
+    // Script printing the value of numExprs expressions as "expr", "if", "while" and "for" conditions, at the top
+    // level and in the (compiled) body of a func.
+    std::string script(int numExprs) {
+        std::string text;
+        for (auto& name : {"a", "b", "c", "d"}) { text += "set " + std::string(name) + " {" + value() + "}\n"; }
+        for (int i = 0; i < numExprs; i++) {
+            std::string e = expr(2), num = std::to_string(i), body;
+            switch (pick(4)) {
+                case 0:  body = "return [expr {" + e + "}]"; break;
+                case 1:  body = "if {" + e + "} {return t} {return f}"; break;
+                case 2:  body = "set n 0; while {" + e + "} {inc n; if {$n > 5} {return $n}}; return $n"; break;
+                default: body = "set n 0; for {set k 0} {$k < " + e + "} {inc k} {inc n; if {$n > 5} {return $n}}; return $n"; break;
+            }
+            if (pick(3)) { // Func with the variables as locals.
+                text += "func e" + num + " {a b c d} {" + body + "}\n";
+                text += "print " + num + " [try {e" + num + " $a $b $c $d} {reflect error}]\n";
+            } else {
+                text += "print " + num + " [try {expr {" + e + "}} {reflect error}]\n";
+            }
+            if (!pick(8)) { text += "set " + var() + " {" + value() + "}\n"; }
+        }
+        return text;
+    }
+};
+
+// Run expressions of seed with compiled expressions and the text way, returns number of differences.
+static int check_expr_fuzz(unsigned seed) { // #UNITTEST
+    std::string script = ExprFuzz(seed).script(60);
+    std::string text   = run_script(script, g_textExprs);
+    int numDiffs = diff_lines(run_script(script, g_modes[0]), text);
+    if (numDiffs) { std::cout << "SCRIPT:\n" << script; }
+    std::cout << "TEST: expr fuzz seed " << seed << " numFail " << numDiffs << (numDiffs ? " ****" : "") << std::endl;
+    return numDiffs;
+}
+
+int main(int argc, const char* argv[]) {
+    int      numErrors = 0;
+    unsigned numSeeds  = 40;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seeds") && i + 1 < argc) { numSeeds = CAST(unsigned)atoi(argv[++i]); }
+        else { numErrors += check_script(argv[i]); }
+    }
+    numErrors += check_settings_kept();
+    numErrors += check_cmd_epochs();
+    numErrors += check_other_thread();
+    numErrors += check_thread_interps();
+    numErrors += check_symbols_freed();
+    for (unsigned seed = 1; seed <= numSeeds; seed++) { numErrors += check_expr_fuzz(seed); }
+    std::cout << "numErrors: " << numErrors << "\n";
+    return numErrors;
+}
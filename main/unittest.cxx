@@ -505,6 +505,51 @@ static const char* expr_lil_result1 = R"Xraw(7 (should be 7))Xraw"; // expr_lil_
 };
 #pragma GCC diagnostic pop
 
+// Changed file: exprcompile.lil to static string exprcompile_lil
+
+static const char* exprcompile_lil = R"Xraw(#
+# Test for compiled expressions: operands that only mean something once the
+# variables are substituted ($a$b, $a.5, 1${a}) have to give what the text
+# of the expression gives, braced or not and in if/while/for conditions
+#
+
+set x 2
+set y 3
+set i 3
+set n 7
+print "braced:   [expr {$x == $y$x}] [expr {$x + $y.5}] [expr {$x * 1${n}}] [expr {$x < $y$y}] [expr {-$x$y + 1}]"
+print "unbraced: [expr $x == $y$x] [expr $x + $y.5] [expr $x * 1${n}] [expr $x < $y$y] [expr -$x$y + 1]"
+print "folded:   [expr {1 + 2 == $y$x}] [expr {$x$x - 1${x} * 2}] [expr {!$x$x || 0}]"
+if {$x < $y$y} { print "if: yes" } { print "if: no" }
+if {$x == $y$x} { print "if: yes" } { print "if: no" }
+set w 0
+while {$w < $i$x} { inc w }
+print "while: $w"
+func g {lim} { set c 0; for {set k 0} {$k < $lim$lim} {inc k} { inc c }; return $c }
+print "for: [g 2]"
+func h {a b} { return [expr {$a * 2 + 1$b}] }
+print "func: [h 3 4]"
+)Xraw"; // exprcompile_lil
+
+// Changed file: exprcompile.lil.result1 to static string exprcompile_lil_result1
+
+static const char* exprcompile_lil_result1 = R"Xraw(braced:   0 1 34 1 -22
+unbraced: 0 1 34 1 -22
+folded:   0 -2 0
+if: yes
+if: no
+while: 32
+for: 22
+func: 20
+)Xraw"; // exprcompile_lil_result1
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+[[maybe_unused]] LilTest  exprcompile_lil_test = {
+        .name_ = "exprcompile_lil", .script_ = exprcompile_lil, .expectedValue_ = exprcompile_lil_result1
+};
+#pragma GCC diagnostic pop
+
 static const char* extract_lil = R"Xraw(#
 # Example for extracting data inside a function by taking
 # advantage of "upeval" and "reflect this"
@@ -968,6 +1013,163 @@ Done
 };
 #pragma GCC diagnostic pop
 
+// Changed file: lset.lil to static string lset_lil
+
+static const char* lset_lil = R"Xraw(#
+# Test for changing lists in variables: append, lset and lreplace
+#
+
+set l [list a b c d e]
+set m $l
+print "lset: [lset l 1 {B B}]"
+print "copy stays: $m"
+print "out of range: [lset l 9 x]"
+lreplace l 1 3 X Y Z
+print "lreplace: $l"
+lreplace l 0 2
+print "remove: $l"
+lreplace l -5 0 first
+print "insert: $l"
+append l last
+print "append: $l ([index $l 5])"
+set t {p   q}
+lset t 0 P
+print "respaced: $t"
+set g {1 2 3}
+func f {} { lset global g 2 three; lreplace g 0 1 one }
+f
+print "global: $g"
+set n {}
+for {set i 0} {$i < 5} {inc i} { append n $i }
+foreach x $n { lset n $x [expr $x * $x] }
+print "squares: $n"
+set l {a b c}
+print "too big: '[lset l 3 x]' negative: '[lset l -1 x]' left: $l"
+print "not a number is 0: [lset l x x]"
+print "clamped: [lreplace l 1 99 Y] | [lreplace l 7 9 end] | [lreplace l 2 1 in] | [lreplace l -3 -1 start]"
+set l {a b c}
+set m $l
+append l d
+lset l 0 A
+lreplace l 1 2 B
+print "copy after append/lset/lreplace: $m | $l"
+func change {x} { lset x 0 X; append x y; return $x }
+set m [change $l]
+print "caller keeps: $l | $m"
+set m $l
+foreach x $m { append l $x }
+print "foreach copy: $m | $l"
+)Xraw"; // lset_lil
+
+// Changed file: lset.lil.result1 to static string lset_lil_result1
+
+static const char* lset_lil_result1 = R"Xraw(lset: a {B B} c d e
+copy stays: a b c d e
+out of range: 
+lreplace: a X Y Z d e
+remove: Y Z d e
+insert: first Y Z d e
+append: first Y Z d e last (last)
+respaced: P q
+global: one 2 three
+squares: 0 1 4 9 16
+too big: '' negative: '' left: a b c
+not a number is 0: x b c
+clamped: x Y | x Y end | x Y in end | start x Y in end
+copy after append/lset/lreplace: a b c | A B c d
+caller keeps: A B c d | X B c d y
+foreach copy: A B c d | A B c d A B c d
+)Xraw"; // lset_lil_result1
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+[[maybe_unused]] LilTest  lset_lil_test = {
+        .name_ = "lset_lil", .script_ = lset_lil, .expectedValue_ = lset_lil_result1
+};
+#pragma GCC diagnostic pop
+
+// Changed file: dict.lil to static string dict_lil
+
+static const char* dict_lil = R"Xraw(#
+# Test for the "dict" command: a dictionary is a list of keys and values
+# with fast lookup by key
+#
+
+set d [dict create apple 1 pear 2 {big fig} 3]
+print "dict: $d"
+print "size: [dict size $d]"
+print "get: [dict get $d pear] [dict get $d {big fig}]"
+print "missing: '[dict get $d plum]'"
+print "exists: '[dict exists $d apple]' '[dict exists $d plum]'"
+set e $d
+dict set d pear 20
+dict set d plum 4
+print "set: $d"
+print "copy stays: $e"
+dict unset d apple
+print "unset: $d"
+print "keys: [dict keys $d]"
+print "values: [dict values $d]"
+print "as list: [index $d 1]"
+print "from list: [dict get {a 1 b 2 a 3} a] [dict size {a 1 b 2 a 3}]"
+dict for k v $d { print "  $k -> $v" }
+dict set new x y
+print "new: $new"
+func f {} { dict set global d apple 100; return [dict get $d apple] }
+print "global: [f] $d"
+set n {}
+for {set i 0} {$i < 100} {inc i} { dict set n k$i $i }
+set sum 0
+foreach k [dict keys $n] { set sum [expr $sum + [dict get $n $k]] }
+print "sum: $sum [dict size $n]"
+set s {a 1 a 2}
+print "duplicates: [dict size $s] '[dict get $s a]' [dict keys $s] text '$s' [index $s 3]"
+dict set s b 3
+print "duplicates after set: $s"
+set d [dict create a 1 b 2 c 3]
+dict for k v $d { dict set d $k [expr $v * 10]; dict unset d b; dict set d x$k $v }
+print "changed in dict for: $d"
+print "missing key: '[dict get $d nope]' '[dict exists $d nope]'"
+set odd {a 1 b}
+print "odd: '[dict size $odd]' '[dict get $odd a]' '[dict keys $odd]' '[dict set odd c 3]' '[dict unset odd a]' left: $odd"
+print "odd create: '[dict create a]' odd for: '[dict for k v {a 1 b} { print never }]'"
+)Xraw"; // dict_lil
+
+// Changed file: dict.lil.result1 to static string dict_lil_result1
+
+static const char* dict_lil_result1 = R"Xraw(dict: apple 1 pear 2 {big fig} 3
+size: 3
+get: 2 3
+missing: ''
+exists: '1' ''
+set: apple 1 pear 20 {big fig} 3 plum 4
+copy stays: apple 1 pear 2 {big fig} 3
+unset: pear 20 {big fig} 3 plum 4
+keys: pear {big fig} plum
+values: 20 3 4
+as list: 20
+from list: 3 2
+  pear -> 20
+  big fig -> 3
+  plum -> 4
+new: x y
+global: 100 pear 20 {big fig} 3 plum 4 apple 100
+sum: 4950 100
+duplicates: 1 '2' a text 'a 1 a 2' 2
+duplicates after set: a 2 b 3
+changed in dict for: a 10 c 30 xa 1 xb 2 xc 3
+missing key: '' ''
+odd: '' '' '' '' '' left: a 1 b
+odd create: '' odd for: ''
+)Xraw"; // dict_lil_result1
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+[[maybe_unused]] LilTest  dict_lil_test = {
+        .name_ = "dict_lil", .script_ = dict_lil, .expectedValue_ = dict_lil_result1
+};
+#pragma GCC diagnostic pop
+
 static const char* local_lil = R"Xraw(#
 # local can be used to "localize" variables in an environment, which is useful
 # to make sure that a global variable with the same name as a local one will
@@ -1774,6 +1976,86 @@ String b splitted:
 };
 #pragma GCC diagnostic pop
 
+// Changed file: tailcall.lil to static string tailcall_lil
+
+static const char* tailcall_lil = R"Xraw(#
+# Test for "tailcall": the called function runs in place of the one that
+# called it, so recursion this way doesn't grow the stack
+#
+
+func count-down {n} {
+    if {$n == 0} { return done }
+    tailcall count-down [expr $n - 1]
+}
+print "count-down: [count-down 20000]"
+
+func sum-to {n total} {
+    if {$n == 0} { return $total }
+    tailcall sum-to [expr $n - 1] [expr $total + $n]
+}
+print "sum-to: [sum-to 20000 0]"
+
+func is-even {n} { if {$n == 0} { return 1 } ; tailcall is-odd [expr $n - 1] }
+func is-odd {n} { if {$n == 0} { return 0 } ; tailcall is-even [expr $n - 1] }
+print "is-even: [is-even 10001] [is-even 20000]"
+
+func fresh {n} {
+    if {[reflect has-var seen]} { return "seen leaked" }
+    set seen 1
+    if {$n} { tailcall fresh [expr $n - 1] }
+    return "no leak"
+}
+print "fresh: [fresh 3]"
+
+func join3 {a b c} { return "$a$b$c" }
+func to-func {} { tailcall join3 a b c }
+print "func: [to-func]"
+func to-cmd {} { tailcall list x y }
+print "cmd: [to-cmd]"
+
+set r [try { tailcall list a } { print "error: [reflect error]" }]
+
+func ret-five {} { tailcall return 5; print "not reached" }
+func nested-ret {} { set r [ret-five]; return "ret-five gave $r" }
+print "return: [nested-ret]"
+func set-up {} { tailcall upeval {set seen up} }
+func nested-upeval {} { set seen no; set-up; return $seen }
+print "upeval: [nested-upeval]"
+func tail-eval {} { tailcall eval {tailcall list in eval} }
+print "eval: [tail-eval]"
+func tail-tail {} { tailcall tailcall join3 x y z }
+print "tailcall: [tail-tail]"
+func tail-error {} { tailcall error oops }
+set r [try { tail-error } { print "error: [reflect error]" }]
+print "top: [ret-five]"
+print "still running"
+)Xraw"; // tailcall_lil
+
+// Changed file: tailcall.lil.result1 to static string tailcall_lil_result1
+
+static const char* tailcall_lil_result1 = R"Xraw(count-down: done
+sum-to: 200010000
+is-even: 0 1
+fresh: no leak
+func: abc
+cmd: x y
+error: tailcall outside of a function
+return: ret-five gave 5
+upeval: up
+eval: in eval
+tailcall: xyz
+error: oops
+top: 5
+still running
+)Xraw"; // tailcall_lil_result1
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+[[maybe_unused]] LilTest  tailcall_lil_test = {
+        .name_ = "tailcall_lil", .script_ = tailcall_lil, .expectedValue_ = tailcall_lil_result1
+};
+#pragma GCC diagnostic pop
+
 static const char* topeval_lil = R"Xraw(#
 # topeval is like an "extreme" version of upeval: it evaluates code at the
 # topmost (global/root) environment.  Like with upeval, downeval can be used
@@ -2059,6 +2341,7 @@ const unittest  ut[] = { // #UNITTEST_VER1
         DEF_UNITEST(downeval_lil, downeval_lil_result1),
         DEF_UNITEST(enveval_lil, enveval_lil_result1),
         DEF_UNITEST(expr_lil, expr_lil_result1),
+        DEF_UNITEST(exprcompile_lil, exprcompile_lil_result1),
         DEF_UNITEST(extract_lil, extract_lil_result1),
         DEF_UNITEST(fileio_lil, fileio_lil_result1),
         DEF_UNITEST(filter_lil, filter_lil_result1),
@@ -2066,6 +2349,8 @@ const unittest  ut[] = { // #UNITTEST_VER1
         DEF_UNITEST(hello_lil, hello_lil_result1),
         DEF_UNITEST(jaileval_lil, jaileval_lil_result1),
         DEF_UNITEST(lists_lil, lists_lil_result1),
+        DEF_UNITEST(lset_lil, lset_lil_result1),
+        DEF_UNITEST(dict_lil, dict_lil_result1),
         DEF_UNITEST(local_lil, local_lil_result1),
         DEF_UNITEST(mandelbrot_lil, mandelbrot_lil_result1),
         DEF_UNITEST(mlcmt_lil, mlcmt_lil_result1),
@@ -2080,6 +2365,7 @@ const unittest  ut[] = { // #UNITTEST_VER1
         DEF_UNITEST(robot_lil, robot_lil_result1),
         DEF_UNITEST(sm_lil, sm_lil_result1),
         DEF_UNITEST(strings_lil, strings_lil_result1),
+        DEF_UNITEST(tailcall_lil, tailcall_lil_result1),
         DEF_UNITEST(topeval_lil, topeval_lil_result1),
         DEF_UNITEST(trim_lil, trim_lil_result1),
         DEF_UNITEST(upeval_lil, upeval_lil_result1),
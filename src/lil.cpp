@@ -29,10 +29,15 @@
 
 #include "lil_inter.h"
 #include "narrow_cast.h"
+#include "ByteScan.h"
 
 #include <cstdlib>
 #include <climits>
 #include <cassert>
+#include <optional>
+#include <algorithm>
+#include <charconv>
+#include <atomic>
 #include "git_info.h"
 
 NS_BEGIN(LILNS)
@@ -52,21 +57,25 @@ const char *getLilCxxGitBranch() { return GIT_BRANCH; }
 #define CAST(X) (X)
 
 // ===============================
-    static Lil_value_Ptr _next_word(LilInterp_Ptr lil);
+    static void _next_word(LilInterp_Ptr lil, Lil_parsedPart& part);
 
     void            _ee_expr(Lil_exprVal* ee);
+    void            _ee_compile(LilInterp_Ptr lil, Lil_exprProgram& prog, const std::vector<Lil_exprCell>& cells);
+    bool            _ee_run(LilInterp_Ptr lil, const Lil_exprProgram& prog, Lil_exprNum& result);
 
     LilInterp::LilInterp(LilInterp* parent) { // #ctor
 //        sysInfo_.logInterpInfo_ = true;        sysInfo_.outputInterpInfoOnExit_ = true;
 //        sysInfo_.outputCoverageOnExit_ = true; sysInfo_.doCoverage_ = true;
 //        sysInfo_.doTiming_ = true;             sysInfo_.doTimeOnExit_ = true;
         parentInterp_ = parent;
+        symbols_ = parent ? parent->symbols_ : std::make_shared<Lil_symbolTable>();
         sysInfo_ = Lil_getSysInfo();
         LIL_CTOR(sysInfo_, "LilInterp");
         this->setRootEnv( this->setEnv(new Lil_callframe(this)) );
         this->setEmptyVal(new Lil_value(this) );
         this->dollarPrefix_ = L_VSTR(0x59e0, "set ");
         register_stdcmds();
+        changeCmdEpoch(); // Not one of another interp, even if register_stdcmds() had nothing to add.
         if (sysInfo_->cmdHTinitSize_) {
             cmdmap_reserve(CAST(size_t)sysInfo_->cmdHTinitSize_);
         }
@@ -79,13 +88,21 @@ const char *getLilCxxGitBranch() { return GIT_BRANCH; }
             this->setCatcherEmpty();
         }
     }
-    inline Lil_func_Ptr LilInterp::find_cmd(lcstrp name) {
-        auto it = cmdMap_.find(name); return (it == cmdMap_.end()) ? (nullptr) : (it->second);
+    inline Lil_func_Ptr LilInterp::find_cmd(lstring_view name) {
+        Lil_sym sym = symbols_->find(name);
+        if (!sym) { return nullptr; }
+        INT i = builtinIndex(sym);
+        if (i >= 0) { return (*builtinCmds_)[CAST(size_t)i]; }
+        auto it = cmdMap_.find(sym); return (it == cmdMap_.end()) ? (nullptr) : (it->second);
     }
     inline Lil_func_Ptr LilInterp::add_func(lcstrp name) {
         Lil_func_Ptr cmdD = find_cmd(name);
         if (cmdD) { // Already have a function by that name so re-are redefining it.
-            cmdD->eraseOrgDefinition();
+            if (isBuiltinCmd(cmdD)) { // Shared so leave it be, hashmap_addCmd() hides it.
+                builtinErased_.set(CAST(size_t)cmdD->name_->builtin_);
+            } else {
+                cmdD->eraseOrgDefinition();
+            }
         }
         cmdD = std::make_shared<Lil_func>(this, name); //alloc Lil_func_Ptr
         hashmap_addCmd(name, cmdD);
@@ -112,8 +129,9 @@ const char *getLilCxxGitBranch() { return GIT_BRANCH; }
         r = new Lil_value(this, func->getName());
         if (newnameObj.length()) {
             hashmap_removeCmd(oldnameObj.c_str());
+            func = ownCmd(func);
+            func->name_ = symbols_->intern(newnameObj);
             hashmap_addCmd(newnameObj.c_str(), func);
-            func->name_ = newnameObj;
             sysInfo_->numRenameCommands_++;
         } else {
             del_func(func);
@@ -131,7 +149,15 @@ const char *getLilCxxGitBranch() { return GIT_BRANCH; }
         }
 #endif
         if (sysInfo_->logInterpInfo_) sysInfo_->numCommandsRegisteredTotal_++;
-        cmdD->setProc(proc);
+        cmdD->setProc(std::move(proc));
+        return true;
+    }
+
+    inline bool LilInterp::registerFunc(lcstrp  name, lil_cmd_fn_t fn, void* ctx) {
+        Lil_func_Ptr cmdD = add_func(name);
+        if (!cmdD) { return false; }
+        if (sysInfo_->logInterpInfo_) sysInfo_->numCommandsRegisteredTotal_++;
+        cmdD->setFn(fn, ctx);
         return true;
     }
 
@@ -217,42 +243,58 @@ Lil_value_Ptr lil_list_get(Lil_list_CPtr list, INT index) {
     return index >= list->getCount() ? nullptr : list->getValue(index);
 }
 
+// Has str a LISPUNCT() or LISSPACE() char (in the "C" locale) or is it empty.
 ND static bool _needs_escape(lstring_view str) { // #private
     if (str.empty() || str.length()==0) { return true; }
-    for (auto ch : str) {
-        if (LISPUNCT(ch) || isspace(ch)) { return true; }
-    }
-    return false;
+    using namespace EjUtil;
+    return findFirstOf<byteIn('\t','\r'), byteIn(' ','/'), byteIn(':','@'), byteIn('[','`'), byteIn('{','~')>(
+               str.data(), str.length()) != str.length(); // #optimization
 }
 
-// Convert list to string representation.
-Lil_value_Ptr lil_list_to_value(LilInterp_Ptr lil, Lil_list_CPtr list, bool do_escape) {
-    assert(lil!=nullptr); assert(list!=nullptr); // #topic listStrLength
-    auto val = new Lil_value(lil);
+// Add strValue to text as word i of a list.
+static void _append_list_word(const lstring& strValue, bool do_escape, INT i, lstring& text) { // #private
+    bool escape = do_escape ? _needs_escape(strValue) : false;
+    if (i) { text += LC(' '); } // Separate each value with ' '.
+    if (escape) { // It needs an escape.
+        text += LC('{'); // Embrace with "{...}".
+        size_t len = strValue.length();
+        for (size_t j = 0; j < len; ) {
+            // Copy up to the next brace at once. #optimization
+            size_t k = j + EjUtil::findFirstOf<EjUtil::byteIs('{'), EjUtil::byteIs('}')>(strValue.data() + j, len - j);
+            text.append(strValue, j, k - j);
+            if (k == len) { break; }
+            text += (strValue[k] == LC('{')) ? L_STR(R"(}"\o"{)") : L_STR(R"(}"\c"{)");
+            j = k + 1;
+        }
+        text += LC('}'); // Embrace with "{...}".
+    } else { text += strValue; }
+}
 
+// Convert list to its string representation in text.
+static void _list_to_text(Lil_list_CPtr list, bool do_escape, lstring& text) { // #private
+    assert(list!=nullptr); // #topic listStrLength
     INT i = 0;
     for (auto it = list->cbegin(); it != list->cend(); ++it) {
         // *it => Lil_value(); it->getValue() => lcstrp
-        auto strValue = (*it)->getValue();
-        auto valLen   = CAST(INT)strValue.length();
-
-        bool escape = do_escape ? _needs_escape(strValue) : false;
-        if (i) { lil_append_char(val, LC(' ')); } // Separate each value with ' '.
-        if (escape) { // It needs an escape.
-            lil_append_char(val, LC('{')); // Embrace with "{...}".
-            for (INT j = 0; j < valLen; j++) {
-                auto jj = CAST(std::string::size_type)j;
-                if (strValue[jj] == LC('{')) {
-                    lil_append_string(val, L_STR(R"(}"\o"{)"));
-                } else if (strValue[jj] == LC('}')) {
-                    lil_append_string(val, L_STR(R"(}"\c"{)"));
-                } else { lil_append_char(val, strValue[jj]); }
-            }
-            lil_append_char(val, LC('}')); // Embrace with "{...}".
-        } else { lil_append_val(val, *it); }
-        i++;
+        _append_list_word((*it)->getValue(), do_escape, i++, text);
     } // for
-    return val;
+}
+
+// Convert dictionary to its string representation "key value key value ..." in text.
+static void _dict_to_text(const Lil_dict& dict, lstring& text) { // #private
+    INT i = 0;
+    dict.forEach([&](const lstring& key, Lil_value_Ptr value) {
+        _append_list_word(key, true, i++, text);
+        _append_list_word(value->getValue(), true, i++, text);
+    });
+}
+
+// Convert list to string representation.
+Lil_value_Ptr lil_list_to_value(LilInterp_Ptr lil, Lil_list_CPtr list, bool do_escape) {
+    assert(lil!=nullptr); assert(list!=nullptr);
+    lstring text;
+    _list_to_text(list, do_escape, text);
+    return new Lil_value(lil, text);
 }
 
 Lil_callframe_Ptr lil_alloc_env(LilInterp_Ptr lil, Lil_callframe_Ptr parent) {
@@ -272,8 +314,13 @@ ND Lil_var_Ptr _lil_find_local_var([[maybe_unused]] LilInterp_Ptr lil, Lil_callf
 // Find variable in either local or global space.
 ND Lil_var_Ptr _lil_find_var(LilInterp_Ptr lil, Lil_callframe_Ptr env, lcstrp name) { // #private
     assert(lil!=nullptr); assert(env!=nullptr); assert(name!=nullptr); // ERROR:no-var
-    Lil_var_Ptr r = _lil_find_local_var(lil, env, name);
-    return r ? r : (env == lil->getRootEnv() ? nullptr : _lil_find_var(lil, lil->getRootEnv(), name));
+    Lil_sym sym = lil->getSymbols().find(name); // Name nothing was ever named by.
+    if (!sym) {
+        lil->sysInfo_->numVarMisses_++;
+        return nullptr;
+    }
+    Lil_var_Ptr r = env->getVar(sym);
+    return r ? r : (env == lil->getRootEnv() ? nullptr : lil->getRootEnv()->getVar(sym));
 }
 
 ND Lil_func_Ptr _find_cmd(LilInterp_Ptr lil, lcstrp name) { // #private
@@ -293,7 +340,12 @@ void _del_func(LilInterp_Ptr lil, Lil_func_Ptr cmd) { // #private
 
 bool lil_register(LilInterp_Ptr lil, lcstrp name, lil_func_proc_t proc) {
     assert(lil!=nullptr); assert(name!=nullptr); assert(proc!=nullptr);
-    return lil->registerFunc(name, proc);
+    return lil->registerFunc(name, std::move(proc));
+}
+
+bool lil_register_fn(LilInterp_Ptr lil, lcstrp name, lil_cmd_fn_t fn, void* ctx) {
+    assert(lil!=nullptr); assert(name!=nullptr); assert(fn!=nullptr);
+    return lil->registerFunc(name, fn, ctx);
 }
 
 Lil_var_Ptr lil_set_var(LilInterp_Ptr lil, lcstrp name, Lil_value_Ptr val, LIL_VAR_TYPE local) {
@@ -337,10 +389,8 @@ Lil_var_Ptr lil_set_var(LilInterp_Ptr lil, lcstrp name, Lil_value_Ptr val, LIL_V
     auto aVal = freeval ? (val):(  // Ugly! Nested "?" operators!
             (val?(lil_clone_value(val)):(nullptr))
             );
-    auto var = new Lil_var(lil, name, nullptr, currCallFrame, aVal);
-    // Put new variable in current callframe hashtable.
-    currCallFrame->hashmap_put(name, var);
-    return var;
+    // Put new variable in current callframe.
+    return currCallFrame->newVar(lil, name, aVal);
 }
 
 // Get variable or return "empty" value.
@@ -367,7 +417,8 @@ Lil_value_Ptr lil_get_var_or(LilInterp_Ptr lil, lcstrp name, Lil_value_Ptr defva
 // Add new callframe.
 Lil_callframe_Ptr lil_push_env(LilInterp_Ptr lil) {
     assert(lil!=nullptr);
-    Lil_callframe_Ptr env = lil_alloc_env(lil, lil->getEnv());
+    Lil_callframe_Ptr env = lil->reuseEnv(lil->getEnv());
+    if (!env) { env = lil_alloc_env(lil, lil->getEnv()); }
     lil->setEnv(env);
     return env;
 }
@@ -376,7 +427,7 @@ void lil_pop_env(LilInterp_Ptr lil) {
     assert(lil!=nullptr);
     if (lil->getEnv()->getParent()) {
         Lil_callframe_Ptr next = lil->getEnv()->getParent();
-        lil_free_env(lil->getEnv());
+        lil->retireEnv(lil->getEnv());
         lil->setEnv(next);
     }
 }
@@ -398,14 +449,31 @@ ND static bool _ateol(LilInterp_Ptr lil) { // #private
     return !(lil->getIgnoreEol()) && _eolchar(lil->getHeadChar());
 }
 
+// Number of chars from head to the first one in the set RS (see EjUtil::findFirstOf()) or to the end of the code.
+template<EjUtil::ByteRange... RS>
+ND static INT _scan_to(LilInterp_Ptr lil) { // #private #optimization
+    if (lil->getHead() >= lil->getCodeLen()) { return 0; }
+    return CAST(INT)EjUtil::findFirstOf<RS...>(lil->getCode() + lil->getHead(), CAST(size_t)(lil->getCodeLen() - lil->getHead()));
+}
+
+// Number of chars from head to the first one not in the set RS or to the end of the code.
+template<EjUtil::ByteRange... RS>
+ND static INT _scan_past(LilInterp_Ptr lil) { // #private #optimization
+    if (lil->getHead() >= lil->getCodeLen()) { return 0; }
+    return CAST(INT)EjUtil::findFirstNotOf<RS...>(lil->getCode() + lil->getHead(), CAST(size_t)(lil->getCodeLen() - lil->getHead()));
+}
+
 // Called from lil_parse(), _next_word(), substitute()
 static void _skip_spaces(LilInterp_Ptr lil) { // #private
     assert(lil!=nullptr);
+    using EjUtil::byteIs;
     while (lil->getHead() < lil->getCodeLen()) {
         if (lil->getHeadChar() == LC('#')) { // Lil comment.
             if (lil->getHeadCharPlus(1) == LC('#') && lil->getHeadCharPlus(2) != LC('#')) {
                 lil->incrHead(2);
                 while (lil->getHead() < lil->getCodeLen()) {
+                    lil->incrHead(_scan_to<byteIs('#')>(lil));
+                    if (lil->getHead() >= lil->getCodeLen()) { break; }
                     if ((lil->getHeadChar() == LC('#')) && (lil->getHeadCharPlus(1) == LC('#')) &&
                         (lil->getHeadCharPlus(2) != LC('#'))) {
                         lil->incrHead(2);
@@ -414,7 +482,7 @@ static void _skip_spaces(LilInterp_Ptr lil) { // #private
                     lil->incrHead(1);
                 }
             } else {
-                while (lil->getHead() < lil->getCodeLen() && !_eolchar(lil->getHeadChar())) { lil->incrHead(1); }
+                lil->incrHead(_scan_to<byteIs('\n'), byteIs('\r'), byteIs(';')>(lil)); // Up to _eolchar().
             }
         } else if (lil->getHeadChar() == LC('\\') && _eolchar(lil->getHeadCharPlus(1))) { // Lil continuation.
             lil->incrHead(1);
@@ -423,120 +491,356 @@ static void _skip_spaces(LilInterp_Ptr lil) { // #private
             if (lil->getIgnoreEol()) { lil->incrHead(1); }
             else { break; }
         } else if (LISSPACE(lil->getHeadChar())) { // Lil space handling
-            lil->incrHead(1);
+            lil->incrHead(_scan_past<byteIs(' '), byteIs('\t'), byteIs('\v'), byteIs('\f')>(lil)); // Spaces but not EOL.
         } else { break; }
     } // while (lil->getHead() < lil->getCodeLen())
 }
 
-// Called from _next_word()
-ND static Lil_value_Ptr _get_bracketpart(LilInterp_Ptr lil) { // #private
+// Slice of the code being parsed, no copy.
+ND static lstring_view _code_view(LilInterp_Ptr lil, INT start, INT end) { // #private
     assert(lil!=nullptr);
-    INT           cnt      = 1;
-    bool          save_eol = lil->getIgnoreEol();
-    Lil_value_Ptr val;
-    Lil_value_SPtr cmd(new Lil_value(lil)); // Delete on exit
+    return lstring_view(lil->getCode() + start, CAST(size_t)(end - start));
+}
 
-    lil->setIgnoreEol() = false;
+// Text between open and matching close char, head is on open char, nested pairs are part of the text.
+// Called from _next_word(), _get_bracketpart()
+template<lchar OPEN, lchar CLOSE>
+ND static lstring_view _get_nested(LilInterp_Ptr lil) { // #private
+    assert(lil!=nullptr);
+    INT cnt = 1;
     lil->incrHead(1);
+    INT start = lil->getHead(), end = lil->getCodeLen();
     while (lil->getHead() < lil->getCodeLen()) {
-        if (lil->getHeadChar() == LC('[')) {
-            lil->incrHead(1);
+        lil->incrHead(_scan_to<EjUtil::byteIs(OPEN), EjUtil::byteIs(CLOSE)>(lil)); // Skip text between.
+        if (lil->getHead() >= lil->getCodeLen()) { break; }
+        if (lil->getHeadChar() == OPEN) {
             cnt++;
-            lil_append_char(cmd.v, LC('['));
-        } else if (lil->getHeadChar() == LC(']')) {
+        } else if (--cnt == 0) { // CLOSE
+            end = lil->getHead();
             lil->incrHead(1);
-            if (--cnt == 0) { break; }
-            else { lil_append_char(cmd.v, LC(']')); }
-        } else {
-            lil_append_char(cmd.v, lil->getHeadCharAndAdvance());
+            break;
         }
+        lil->incrHead(1);
     }
-    val = lil_parse_value(lil, cmd.v, 0);
-    lil->setIgnoreEol() = save_eol;
-    return val;
+    return _code_view(lil, start, end);
+}
+
+// Called from _next_word()
+static void _get_bracketpart(LilInterp_Ptr lil, Lil_parsedPart& part) { // #private
+    assert(lil!=nullptr);
+    part.type_ = LIL_PART_BRACKET;
+    part.src_  = _get_nested<LC('['), LC(']')>(lil);
 }
 
 // Called from _next_word().
-ND static Lil_value_Ptr _get_dollarpart(LilInterp_Ptr lil) { // #private
+static void _get_dollarpart(LilInterp_Ptr lil, Lil_parsedPart& part) { // #private
     assert(lil!=nullptr);
     lil->incrHead(1);
-    Lil_value_SPtr name(_next_word(lil)); // Delete on exit.
-    Lil_value_SPtr tmp(new Lil_value(lil, lil->getDollarPrefix())); // Delete on exit
-    lil_append_val(tmp.v, name.v);
-    Lil_value_Ptr val = lil_parse_value(lil, tmp.v, 0);
-    return val;
+    part.type_ = LIL_PART_DOLLAR;
+    part.parts_.resize(1);
+    _next_word(lil, part.parts_[0]);
 }
 
-// Called from _get_dollarpart(), substitute()
-ND static Lil_value_Ptr _next_word(LilInterp_Ptr lil) { // #private
+// Add the len characters at head to the literal at the end of the quote parts, it stays a slice of the code
+// until an escape makes it different.
+static void _append_quotesrc(LilInterp_Ptr lil, Lil_parsedPart& part, INT len) { // #private
+    assert(lil!=nullptr);
+    if (!part.parts_.empty() && part.parts_.back().type_ == LIL_PART_LITERAL) {
+        auto& last = part.parts_.back();
+        if (last.isOwn_) {
+            last.own_.append(lil->getCode() + lil->getHead(), CAST(size_t)len);
+            return;
+        }
+        if (last.src_.data() + last.src_.size() == lil->getCode() + lil->getHead()) {
+            last.src_ = lstring_view(last.src_.data(), last.src_.size() + CAST(size_t)len);
+            return;
+        }
+    }
+    part.parts_.emplace_back().src_ = _code_view(lil, lil->getHead(), lil->getHead() + len);
+}
+
+// Add an escaped character to the literal at the end of the quote parts.
+static void _append_quotechar(Lil_parsedPart& part, lchar ch) { // #private
+    if (part.parts_.empty() || part.parts_.back().type_ != LIL_PART_LITERAL) {
+        part.parts_.emplace_back();
+    }
+    auto& last = part.parts_.back();
+    if (!last.isOwn_) {
+        last.own_  = lstring(last.src_);
+        last.isOwn_ = true;
+    }
+    last.own_.push_back(ch);
+}
+
+// Called from _get_dollarpart(), _substitute()
+static void _next_word(LilInterp_Ptr lil, Lil_parsedPart& part) { // #private
     assert(lil!=nullptr);
-    Lil_value_Ptr val;
     INT        start;
     _skip_spaces(lil);
     if (lil->getHeadChar() == LC('$')) { // Deref a value.
-        val = _get_dollarpart(lil);
+        _get_dollarpart(lil, part);
     } else if (lil->getHeadChar() == LC('{')) { // Start of a list.
-        INT cnt = 1;
-        lil->incrHead(1);
-        val = new Lil_value(lil);
-        while (lil->getHead() < lil->getCodeLen()) {
-            if (lil->getHeadChar() == LC('{')) {
-                lil->incrHead(1);
-                cnt++;
-                lil_append_char(val, LC('{'));
-            } else if (lil->getHeadChar() == LC('}')) {
-                lil->incrHead(1);
-                if (--cnt == 0) break;
-                else lil_append_char(val, LC('}'));
-            } else {
-                lil_append_char(val, lil->getHeadCharAndAdvance());
-            }
-        } // while (lil->getHead() < lil->getCodeLen())
+        part.src_ = _get_nested<LC('{'), LC('}')>(lil);
     } else if (lil->getHeadChar() == LC('[')) { // Start of a command.
-        val = _get_bracketpart(lil);
+        _get_bracketpart(lil, part);
     } else if (lil->getHeadChar() == LC('"') || lil->getHeadChar() == LC('\'')) {
         lchar sc = lil->getHeadCharAndAdvance();
-        val = new Lil_value(lil);
+        part.type_ = LIL_PART_QUOTE;
         while (lil->getHead() < lil->getCodeLen()) {
             if (lil->getHeadChar() == LC('[') || lil->getHeadChar() == LC('$')) { // Deref a value.
-                Lil_value_SPtr tmp(lil->getHeadChar() == LC('$') ? _get_dollarpart(lil) : _get_bracketpart(lil)); // Delete on exit
-                lil_append_val(val, tmp.v);
+                part.parts_.emplace_back();
+                if (lil->getHeadChar() == LC('$')) { _get_dollarpart(lil, part.parts_.back()); }
+                else { _get_bracketpart(lil, part.parts_.back()); }
                 lil->incrHead(-1); /* avoid skipping the char below */
             } else if (lil->getHeadChar() == LC('\\')) { // Escaped character
                 lil->incrHead(1);
                 switch (lil->getHeadChar()) { // Handling different forms of escape.
-                    case LC('b'): lil_append_char(val, LC('\b')); break;
-                    case LC('t'): lil_append_char(val, LC('\t')); break;
-                    case LC('n'): lil_append_char(val, LC('\n')); break;
-                    case LC('v'): lil_append_char(val, LC('\v')); break;
-                    case LC('f'): lil_append_char(val, LC('\f')); break;
-                    case LC('r'): lil_append_char(val, LC('\r')); break;
-                    case LC('0'): lil_append_char(val, LC('\0')); break;
-                    case LC('a'): lil_append_char(val, LC('\a')); break;
-                    case LC('c'): lil_append_char(val, LC('}')); break;
-                    case LC('o'): lil_append_char(val, LC('{')); break;
-                    default: lil_append_char(val, lil->getHeadChar()); break;
+                    case LC('b'): _append_quotechar(part, LC('\b')); break;
+                    case LC('t'): _append_quotechar(part, LC('\t')); break;
+                    case LC('n'): _append_quotechar(part, LC('\n')); break;
+                    case LC('v'): _append_quotechar(part, LC('\v')); break;
+                    case LC('f'): _append_quotechar(part, LC('\f')); break;
+                    case LC('r'): _append_quotechar(part, LC('\r')); break;
+                    case LC('0'): _append_quotechar(part, LC('\0')); break;
+                    case LC('a'): _append_quotechar(part, LC('\a')); break;
+                    case LC('c'): _append_quotechar(part, LC('}')); break;
+                    case LC('o'): _append_quotechar(part, LC('{')); break;
+                    default: _append_quotechar(part, lil->getHeadChar()); break;
                 }
             } else if (lil->getHeadChar() == sc) {
                 lil->incrHead(1);
                 break;
-            } else {
-                lil_append_char(val, lil->getHeadChar());
+            } else { // Plain text up to the next char handled above. #optimization
+                using EjUtil::byteIs;
+                INT len = std::max<INT>(1, _scan_to<byteIs('['), byteIs('$'), byteIs('\\'), byteIs('"'), byteIs('\'')>(lil));
+                _append_quotesrc(lil, part, len);
+                lil->incrHead(len - 1);
             }
             lil->incrHead(1);
         } // while (lil->getHead() < lil->getCodeLen())
     } else {
         start = lil->getHead();
-        while (lil->getHead() < lil->getCodeLen() && !LISSPACE(lil->getHeadChar()) && !_islilspecial(lil->getHeadChar())) {
-            lil->incrHead(1);
-        }
-        val = new Lil_value(lil, lil->getCodeObj().substr(CAST(size_t)start, CAST(size_t)(lil->getHead()-start)));
+        using EjUtil::byteIs;
+        lil->incrHead(_scan_to<byteIs(' '), EjUtil::byteIn('\t', '\r'), // Up to LISSPACE() or _islilspecial().
+                               byteIs('$'), byteIs('{'), byteIs('}'), byteIs('['), byteIs(']'), byteIs('"'), byteIs('\''),
+                               byteIs(';')>(lil));
+        part.src_ = _code_view(lil, start, lil->getHead());
     }
+}
+
+// Called from _parse_code()
+static void _substitute(LilInterp_Ptr lil, Lil_parsedCmd& cmd) {// #private
+    assert(lil!=nullptr);
+    _skip_spaces(lil);
+    while (lil->getHead() < lil->getCodeLen() && !_ateol(lil)) {
+        bool wordStart = true;
+        do {
+            INT            head = lil->getHead();
+            Lil_parsedPart wp;
+            _next_word(lil, wp);
+            if (head == lil->getHead()) { /* something wrong, the parser can't proceed */
+                cmd.parseError_ = true;
+                return;
+            }
+            wp.wordStart_ = wordStart;
+            wordStart     = false;
+            cmd.parts_.push_back(std::move(wp));
+        } while (lil->getHead() < lil->getCodeLen() && !_eolchar(lil->getHeadChar()) && !LISSPACE(lil->getHeadChar()));
+        _skip_spaces(lil);
+    } // while (lil->getHead() < lil->getCodeLen() && !ateol(lil))
+}
+
+// Leave any code pushed since this was made, even when an exception unwinds past the parse.
+struct Lil_codeRestore { // #class #private
+    LilInterp_Ptr lil_;
+    size_t        depth_;
+    explicit Lil_codeRestore(LilInterp_Ptr lil) : lil_(lil), depth_(lil->getCodeDepth()) { } // #ctor
+    ~Lil_codeRestore() { lil_->popCode(depth_); } // #dtor
+    Lil_codeRestore(const Lil_codeRestore&) = delete;
+    Lil_codeRestore& operator=(const Lil_codeRestore&) = delete;
+};
+
+// Tokenize code into commands, words and parts without running anything.
+ND static Lil_parsedCode_Ptr _parse_code(LilInterp_Ptr lil, lcstrp code, INT codelen) { // #private
+    assert(lil!=nullptr); assert(code!=nullptr);
+    auto parsed = std::make_shared<Lil_parsedCode>();
+    parsed->code_      = lstring(code, CAST(size_t)codelen);
+    parsed->codeLen_   = codelen;
+    parsed->ignoreEol_ = lil->getIgnoreEol();
+
+    Lil_codeRestore restore(lil); // Parts are slices of parsed->code_, parse it in place.
+    lil->pushCode(parsed->code_.c_str(), codelen);
+    _skip_spaces(lil);
+    while (lil->getHead() < lil->getCodeLen()) {
+        auto& cmd = parsed->cmds_.emplace_back();
+        _substitute(lil, cmd);
+        cmd.head_    = lil->getHead();
+        cmd.litName_ = !cmd.parts_.empty() && cmd.parts_[0].type_ == LIL_PART_LITERAL &&
+                       (cmd.parts_.size() == 1 || cmd.parts_[1].wordStart_);
+        if (cmd.parseError_) { break; }
+
+        // Continue past any "junk" at end of command.
+        _skip_spaces(lil);
+        while (_ateol(lil)) lil->incrHead(1);
+        _skip_spaces(lil);
+    }
+    return parsed;
+}
+
+// Get parsed code from cache or parse it now.
+ND static Lil_parsedCode_Ptr _find_parsed_code(LilInterp_Ptr lil, lcstrp code, INT codelen) { // #private
+    assert(lil!=nullptr); assert(code!=nullptr);
+    auto parsed = lil->findParsedCode(lstring_view(code, CAST(size_t)codelen), lil->getIgnoreEol());
+    if (!parsed) {
+        parsed = _parse_code(lil, code, codelen);
+        lil->addParsedCode(parsed);
+    }
+    return parsed;
+}
+
+// Get parsed body of a "proc" command, it's kept with the function until the code changes.
+ND static Lil_parsedCode_Ptr _find_func_parsed_code(LilInterp_Ptr lil, Lil_func_Ptr cmd) { // #private
+    assert(lil!=nullptr); assert(cmd!=nullptr);
+    auto parsed = cmd->getParsedCode();
+    if (!parsed || parsed->ignoreEol_ != lil->getIgnoreEol()) {
+        parsed = _parse_code(lil, cmd->getCode()->getValue().c_str(), cmd->getCode()->getValueLen());
+        cmd->setParsedCode(parsed);
+    }
+    return parsed;
+}
+
+ND static Lil_value_Ptr _run_parsed_code(LilInterp_Ptr lil, const Lil_parsedCode_Ptr& parsed, lcstrp code, INT funclevel);
+ND static Lil_value_Ptr _run_cmd(LilInterp_Ptr lil, Lil_list_Ptr words, Lil_cmdSite* site = nullptr);
+ND static Lil_value_Ptr _run_func_body(LilInterp_Ptr lil, Lil_func_Ptr cmd);
+ND static Lil_bytecode_Ptr _find_func_bytecode(LilInterp_Ptr lil, Lil_func_Ptr cmd);
+
+// Append literal text of a part.
+static void _append_text(Lil_value_Ptr val, lstring_view text) { // #private
+    if (!text.empty()) { lil_append_string_len(val, text.data(), CAST(INT)text.length()); }
+}
+
+// Is name read the same by "set name" as by $name.  Called from _eval_part(), Lil_compiler::part()
+ND static bool _is_plain_name(lstring_view name) { // #private
+    if (name.empty() || name == L_STR("global")) { return false; }
+    for (auto ch : name) {
+        if (LISSPACE(ch) || _islilspecial(ch) || _eolchar(ch) || ch == LC('#') || ch == LC('\\')) { return false; }
+    }
+    return true;
+}
+
+// Would running "set name" for $name just read the variable?  set is the builtin setFunc and the parse level
+// it takes is allowed.  Called from _eval_part(), Lil_vm::loadVar()
+ND static bool _can_read_var(LilInterp_Ptr lil, Lil_func_Ptr setFunc) { // #private
+    return setFunc && lil->getDollarPrefix() == L_STR("set ") && !lil->getError().inError() &&
+           lil->find_cmd(L_STR("set"), lil->getSetSite()) == setFunc && lil->getParse_depth() + 1 < lil->sysInfo_->limit_ParseDepth_;
+}
+
+// Value of $name when _can_read_var(), what "set name" returns.  Called from _eval_part(), Lil_vm::loadVar()
+ND static Lil_value_Ptr _read_var(LilInterp_Ptr lil, lcstrp name) { // #private
+    lil->sysInfo_->numDirectVarReads_++;
+    Lil_value_Ptr val = lil_clone_value(lil_get_var(lil, name));
     return val ? val : new Lil_value(lil);
 }
 
-// Called from lil_parse(), lil_subst_to_list()
-ND static Lil_list_Ptr _substitute(LilInterp_Ptr lil) {// #private
+// Get value of a part of a word.
+ND static Lil_value_Ptr _eval_part(LilInterp_Ptr lil, Lil_parsedPart& part) { // #private
+    assert(lil!=nullptr);
+    switch (part.type_) {
+        case LIL_PART_LITERAL:
+            return new Lil_value(lil, part.text());
+        case LIL_PART_BRACKET: {
+            bool          save_eol = lil->getIgnoreEol();
+            Lil_value_Ptr val;
+            lil->setIgnoreEol() = false;
+            if (part.src_.empty()) {
+                val = new Lil_value(lil);
+            } else {
+                if (!part.code_) { part.code_ = _parse_code(lil, part.src_.data(), CAST(INT)part.src_.length()); }
+                Lil_parsedCode_Ptr parsed = part.code_; // Keep alive while running.
+                val = _run_parsed_code(lil, parsed, parsed->code_.c_str(), 0);
+            }
+            lil->setIgnoreEol() = save_eol;
+            return val;
+        }
+        case LIL_PART_DOLLAR: {
+            Lil_value_SPtr name(_eval_part(lil, part.parts_[0])); // Delete on exit.
+            if (_is_plain_name(name.v->getValue()) && _can_read_var(lil, lil->find_sys_cmd(L_STR("set")))) { // #optimization
+                return _read_var(lil, name.v->getValue().c_str());
+            }
+            Lil_value_SPtr tmp(new Lil_value(lil, lil->getDollarPrefix())); // Delete on exit
+            lil_append_val(tmp.v, name.v);
+            return lil_parse_value(lil, tmp.v, 0);
+        }
+        case LIL_PART_QUOTE: {
+            auto val = new Lil_value(lil);
+            for (auto& qp : part.parts_) {
+                if (qp.type_ == LIL_PART_LITERAL) {
+                    _append_text(val, qp.text());
+                } else {
+                    Lil_value_SPtr tmp(_eval_part(lil, qp)); // Delete on exit
+                    lil_append_val(val, tmp.v);
+                }
+            }
+            return val;
+        }
+        default:
+            return new Lil_value(lil);
+    }
+}
+
+// Memory for the words lists of the commands run by one parse level or bytecode run, released after each command.
+// Those lists are made for every command and freed right after it, so their arrays come from a buffer on the stack
+// instead of the heap.  The values in them are still separate objects, so values a command keeps (results,
+// variables) never point into the arena. #optimization
+struct Lil_cmdArena { // #class
+private:
+    alignas(std::max_align_t) std::byte buffer_[256]; // #magic Room for about 30 words.
+    std::pmr::monotonic_buffer_resource mem_{buffer_, sizeof(buffer_)};
+public:
+    // New words list with room for count words.  Free it before release().
+    ND Lil_list_Ptr alloc_list(LilInterp_Ptr lil, INT count) {
+        auto words = new Lil_list(lil, &mem_);
+        words->reserve(count);
+        return words;
+    }
+    // Give back the memory of all the lists, must be after they are freed.
+    void release() { mem_.release(); }
+};
+
+// Get values of the words of a command.  Words list is from arena if it isn't nullptr.  Called from lil_parse(),
+// lil_subst_to_list()
+ND static Lil_list_Ptr _substitute_words(LilInterp_Ptr lil, Lil_parsedCmd& cmd, Lil_cmdArena* arena = nullptr) {// #private
+    assert(lil!=nullptr);
+    auto&        parts = cmd.parts_;
+    Lil_list_Ptr words = arena ? arena->alloc_list(lil, CAST(INT)parts.size()) : lil_alloc_list(lil);
+    size_t       i     = 0;
+
+    while (i < parts.size()) {
+        if (lil->getError().inError()) { return words; }
+        if (parts[i].type_ == LIL_PART_LITERAL && (i + 1 == parts.size() || parts[i + 1].wordStart_)) {
+            // Plain word, no need to append.
+            lil_list_append(words, new Lil_value(lil, parts[i++].text()));
+            continue;
+        }
+        auto w = new Lil_value(lil);
+        do {
+            Lil_value_SPtr wp(_eval_part(lil, parts[i++])); // Delete on exit.
+            lil_append_val(w, wp.v);
+            if (lil->getError().inError()) { break; }
+        } while (i < parts.size() && !parts[i].wordStart_);
+        lil_list_append(words, w);
+    }
+    if (cmd.parseError_ && !lil->getError().inError()) { /* something wrong, the parser can't proceed */
+        lil_free_list(words);
+        LIL_PARSE_ERROR(lil->sysInfo_);
+        return nullptr; // #ERR_RET ERROR:parsing
+    }
+    return words;
+}
+
+// Split code with no substitutions (no '$' or '[') straight into values, nothing worth keeping a parse of.
+// Called from lil_subst_to_list()
+ND static Lil_list_Ptr _substitute_plain(LilInterp_Ptr lil) {// #private
     assert(lil!=nullptr);
     Lil_list_Ptr words = lil_alloc_list(lil);
 
@@ -544,15 +848,20 @@ ND static Lil_list_Ptr _substitute(LilInterp_Ptr lil) {// #private
     while (lil->getHead() < lil->getCodeLen() && !_ateol(lil) && !lil->getError().inError()) {
         auto w = new Lil_value(lil);
         do {
-            INT        head = lil->getHead();
-            Lil_value_SPtr wp(_next_word(lil)); // Delete on exit.
+            INT            head = lil->getHead();
+            Lil_parsedPart wp;
+            _next_word(lil, wp);
             if (head == lil->getHead()) { /* something wrong, the parser can't proceed */
                 lil_free_value(w);
                 lil_free_list(words);
                 LIL_PARSE_ERROR(lil->sysInfo_);
                 return nullptr; // #ERR_RET ERROR:parsing
             }
-            lil_append_val(w, wp.v);
+            if (wp.type_ == LIL_PART_LITERAL) {
+                _append_text(w, wp.text());
+            } else {
+                for (auto& qp : wp.parts_) { _append_text(w, qp.text()); }
+            }
         } while (lil->getHead() < lil->getCodeLen() && !_eolchar(lil->getHeadChar()) && !LISSPACE(lil->getHeadChar()) && !lil->getError().inError());
         _skip_spaces(lil);
 
@@ -562,19 +871,247 @@ ND static Lil_list_Ptr _substitute(LilInterp_Ptr lil) {// #private
     return words;
 }
 
+// Split text with no substitutions into a list, nullptr on parse errors.
+ND static Lil_list_Ptr _split_plain(LilInterp_Ptr lil, const lstring& text) { // #private
+    assert(lil!=nullptr);
+    INT          save_igeol = lil->getIgnoreEol();
+    Lil_list_Ptr words;
+    lil->setIgnoreEol() = true;
+    {
+        Lil_codeRestore restore(lil);
+        lil->pushCode(text.c_str(), CAST(INT)text.length());
+        words = _substitute_plain(lil);
+    }
+    lil->setIgnoreEol() = save_igeol;
+    return words;
+}
+
+// List of val for reading, split once and kept on val (#optimization).  nullptr if the text of val has
+// substitutions ('$' or '['), those have to be done by lil_subst_to_list() each time.
+Lil_listRep_Ptr _value_list(LilInterp_Ptr lil, Lil_value_Ptr val) {
+    assert(lil!=nullptr); assert(val!=nullptr);
+    if (val->getListRep()) {
+        lil->sysInfo_->numListRepHits_++;
+        return val->getListRep();
+    }
+    auto& text = val->getValue();
+    if (text.find_first_of(L_STR("$[")) != lstring::npos) { return nullptr; }
+    Lil_list_Ptr words = _split_plain(lil, text);
+    if (!words) { return Lil_listRep_Ptr(lil_alloc_list(lil)); } // Parse error, nothing to keep.
+    Lil_listRep_Ptr list(words);
+    if (!lil->getError().inError()) {
+        lil->sysInfo_->numListRepBuilds_++;
+        val->cacheListRep(list);
+    }
+    return list;
+}
+
+Lil_listRef::Lil_listRef(LilInterp_Ptr lil, Lil_value_Ptr val) : v(_value_list(lil, val)) { // #ctor
+    if (!v) { v.reset(lil_subst_to_list(lil, val)); }
+}
+
+// Value of list, its string is made the way lil_list_to_value() does when needed.  Takes ownership of list.
+Lil_value_Ptr _list_to_cached_value(LilInterp_Ptr lil, Lil_list_Ptr list) {
+    assert(lil!=nullptr); assert(list!=nullptr);
+    auto val = new Lil_value(lil);
+    val->setList(Lil_listRep_Ptr(list)); // Escaped words split back into the same words.
+    return val;
+}
+
+// Value of variable name if it can be changed in place, the way lil_get_var() then lil_set_var() would
+// change it, else nullptr.  Called from _own_var_list(), _own_var_dict()
+ND static Lil_value_Ptr _own_var_value(LilInterp_Ptr lil, lcstrp name, LIL_VAR_TYPE access) { // #private
+    if (lil->getCallback(LIL_CALLBACK_GETVAR) || lil->getCallback(LIL_CALLBACK_SETVAR)) { return nullptr; }
+    Lil_var_Ptr var = _lil_find_var(lil, lil->getEnv(), name);
+    if (!var || !var->getValue() || var->hasWatchCode()) { return nullptr; }
+    if (access == LIL_SETVAR_GLOBAL && _lil_find_var(lil, lil->getRootEnv(), name) != var) { return nullptr; }
+    return var->getValue();
+}
+
+// List in variable name for changing in place (#optimization), the variable's value gets a list of its own
+// (copied if it's shared).  Call listChanged() on val after changing the list.  nullptr if the change has
+// to go through lil_get_var()/lil_set_var() instead (callbacks, watch code, no such variable, substitutions).
+Lil_list_Ptr _own_var_list(LilInterp_Ptr lil, lcstrp name, LIL_VAR_TYPE access, Lil_value_Ptr& val) {
+    assert(lil!=nullptr); assert(name!=nullptr);
+    val = _own_var_value(lil, name, access);
+    if (!val) { return nullptr; }
+    auto list = _value_list(lil, val);
+    if (!list) { return nullptr; }
+    if (val->getListRep() == list && list.use_count() > 2) { // Shared with some other value.
+        auto copy = lil_alloc_list(lil);
+        for (auto it = list->cbegin(); it != list->cend(); ++it) { lil_list_append(copy, lil_clone_value(*it)); }
+        list.reset(copy);
+        lil->sysInfo_->numListRepCopies_++;
+    }
+    val->cacheListRep(list);
+    return list.get();
+}
+
+// Dictionary of val for reading, made from its list of keys and values and kept on val when the list is.
+// nullptr if the list has a key without a value.
+Lil_dictRep_Ptr _value_dict(LilInterp_Ptr lil, Lil_value_Ptr val) {
+    assert(lil!=nullptr); assert(val!=nullptr);
+    if (val->getDictRep()) { return val->getDictRep(); }
+    Lil_listRef list(lil, val);
+    if (list.v->getCount() % 2) { return nullptr; } // #ERR_RET
+    Lil_dictRep_Ptr dict = std::make_shared<Lil_dict>(lil);
+    for (INT i = 0; i < list.v->getCount(); i += 2) {
+        dict->set(list.v->getValue(i)->getValue(), lil_clone_value(list.v->getValue(i + 1)));
+    }
+    if (val->getListRep()) { val->cacheDictRep(dict); } // Text had no substitutions.
+    return dict;
+}
+
+// Value of dict, its string is made when needed.
+Lil_value_Ptr _dict_to_value(LilInterp_Ptr lil, Lil_dictRep_Ptr dict) {
+    assert(lil!=nullptr); assert(dict!=nullptr);
+    auto val = new Lil_value(lil);
+    val->setDict(std::move(dict));
+    return val;
+}
+
+// Dictionary in variable name for changing in place, like _own_var_list().  Call dictChanged() on val after
+// changing the dictionary.
+Lil_dict* _own_var_dict(LilInterp_Ptr lil, lcstrp name, LIL_VAR_TYPE access, Lil_value_Ptr& val) {
+    assert(lil!=nullptr); assert(name!=nullptr);
+    val = _own_var_value(lil, name, access);
+    if (!val) { return nullptr; }
+    auto dict = _value_dict(lil, val);
+    if (!dict) { return nullptr; }
+    if (val->getDictRep() == dict && dict.use_count() > 2) { // Shared with some other value.
+        dict = std::make_shared<Lil_dict>(*dict);
+    }
+    val->cacheDictRep(dict);
+    return dict.get();
+}
+
+// Integer written the way "inc" writes one (no '+', leading zeros or "-0"), so it reads back the same number.
+ND static bool _counted_int(lstring_view text, lilint_t& num) { // #private
+    lstring_view digits = (!text.empty() && text[0] == LC('-')) ? text.substr(1) : text;
+    if (digits.empty() || (digits[0] == LC('0') && text != L_STR("0"))) { return false; }
+    auto res = std::from_chars(text.data(), text.data() + text.length(), num);
+    return res.ec == std::errc() && res.ptr == text.data() + text.length();
+}
+
+// Split text at spaces and tabs into words, returns number of words or 4 if there are more than 3.
+ND static size_t _counted_words(lstring_view text, lstring_view (&words)[3]) { // #private
+    size_t num = 0, i = 0;
+    for (;;) {
+        while (i < text.length() && (text[i] == LC(' ') || text[i] == LC('\t'))) { i++; }
+        if (i == text.length()) { return num; }
+        if (num == 3) { return 4; }
+        size_t start = i;
+        while (i < text.length() && text[i] != LC(' ') && text[i] != LC('\t')) { i++; }
+        words[num++] = text.substr(start, i - start);
+    }
+}
+
+// Word "$name" with name only letters, digits and '_'.
+ND static bool _counted_var_word(lstring_view word, lstring& name) { // #private
+    if (word.length() < 2 || word[0] != LC('$')) { return false; }
+    for (auto ch : word.substr(1)) {
+        if (!isalnum(CAST(unsigned char)ch) && ch != LC('_')) { return false; }
+    }
+    name = word.substr(1);
+    return true;
+}
+
+// Is cond the condition of a counted loop, if so fill it in loop.  Called from fnc_while, fnc_for, _compile_func()
+bool _match_counted_cond(lstring_view cond, Lil_countedLoop& loop) {
+    static const std::pair<lstring_view,LIL_COUNTED_OP> ops[] = {
+        {L_STR("<"), LIL_COUNT_LT}, {L_STR("<="), LIL_COUNT_LE}, {L_STR(">"), LIL_COUNT_GT},
+        {L_STR(">="), LIL_COUNT_GE}, {L_STR("=="), LIL_COUNT_EQ}, {L_STR("!="), LIL_COUNT_NE},
+    };
+    lstring_view words[3];
+    if (_counted_words(cond, words) != 3 || !_counted_var_word(words[0], loop.var_)) { return false; }
+    auto op = std::find_if(std::begin(ops), std::end(ops), [&](auto& o) { return o.first == words[1]; });
+    if (op == std::end(ops)) { return false; }
+    loop.op_ = op->second;
+    loop.limitVar_.clear();
+    return _counted_var_word(words[2], loop.limitVar_) || _counted_int(words[2], loop.limit_);
+}
+
+// Is step the step of counted loop (after its condition was matched), if so fill it in loop.
+bool _match_counted_step(lstring_view step, Lil_countedLoop& loop) {
+    lstring_view words[3];
+    size_t       num = _counted_words(step, words);
+    lilint_t     by  = 1;
+    if ((num != 2 && num != 3) || (words[0] != L_STR("inc") && words[0] != L_STR("dec")) || words[1] != loop.var_) {
+        return false;
+    }
+    if (num == 3 && !_counted_int(words[2], by)) { return false; }
+    loop.stepCmd_ = words[0];
+    loop.by_      = words[0] == L_STR("inc") ? by : -by;
+    return true;
+}
+
+// Integer in variable name, false if its value isn't one.
+ND static bool _counted_var(LilInterp_Ptr lil, const lstring& name, lilint_t& num) { // #private
+    Lil_var_Ptr var = _lil_find_var(lil, lil->getEnv(), name.c_str());
+    if (!var || !var->getValue()) { return false; }
+    return var->getValue()->getExactInteger(num) || _counted_int(var->getValue()->getValue(), num);
+}
+
+// Condition of counted loop with native integers: 1 true, 0 false or -1 if lil_eval_expr() has to do it (reading
+// a variable could end differently, a value isn't an integer or countedLoops_ is off).  setFunc is the builtin "set".
+INT _counted_test(LilInterp_Ptr lil, const Lil_countedLoop& loop, Lil_func_Ptr setFunc) {
+    assert(lil!=nullptr);
+    lilint_t num, limit = loop.limit_;
+    if (!lil->sysInfo_->countedLoops_ || lil->getCallback(LIL_CALLBACK_GETVAR) || !_can_read_var(lil, setFunc) ||
+        !_counted_var(lil, loop.var_, num) ||
+        (!loop.limitVar_.empty() && !_counted_var(lil, loop.limitVar_, limit))) {
+        return -1;
+    }
+    lil->sysInfo_->numCountedTests_++;
+    switch (loop.op_) {
+        case LIL_COUNT_LT: return num < limit;
+        case LIL_COUNT_LE: return num <= limit;
+        case LIL_COUNT_GT: return num > limit;
+        case LIL_COUNT_GE: return num >= limit;
+        case LIL_COUNT_EQ: return num == limit;
+        case LIL_COUNT_NE:
+        default:           return num != limit;
+    }
+}
+
+// Step of counted loop with native integers, does what "inc"/"dec" does as long as it is still the builtin (caller
+// checks that).  false if the step's code has to be run instead.
+bool _counted_step(LilInterp_Ptr lil, const Lil_countedLoop& loop) {
+    assert(lil!=nullptr);
+    static constexpr lilint_t EXACT = lilint_t(1) << 53; // "inc" adds doubles. #magic
+    if (lil->getError().inError() || lil->getParse_depth() + 1 >= lil->sysInfo_->limit_ParseDepth_) { return false; }
+    Lil_value_Ptr value = _own_var_value(lil, loop.var_.c_str(), LIL_SETVAR_LOCAL);
+    lilint_t      num;
+    if (!value || !(value->getExactInteger(num) || _counted_int(value->getValue(), num))) { return false; }
+    if (num < -EXACT || num > EXACT || loop.by_ < -EXACT || loop.by_ > EXACT) { return false; }
+    num += loop.by_;
+    if (num < -EXACT || num > EXACT) { return false; }
+    value->setInteger(num);
+    return true;
+}
+
 // Convert a variable to a list.
 Lil_list_Ptr lil_subst_to_list(LilInterp_Ptr lil, Lil_value_Ptr code) {
     assert(lil!=nullptr); assert(code!=nullptr);
-    auto save_code = lil->getCodeObj();
-    INT     save_clen  = lil->getCodeLen();
-    INT     save_head  = lil->getHead();
-    INT     save_igeol = lil->getIgnoreEol();
-    lil->setCode(code->getValue().c_str(), code->getValueLen());
-    lil->setIgnoreEol() = true;
-    Lil_list_Ptr words = _substitute(lil);
+    Lil_list_Ptr words;
+    if (auto& list = code->getListRep()) { // Copy of the cached words, caller owns the result.
+        lil->sysInfo_->numListRepHits_++;
+        words = lil_alloc_list(lil);
+        for (auto it = list->cbegin(); it != list->cend(); ++it) { lil_list_append(words, lil_clone_value(*it)); }
+        return words;
+    }
+    auto&        text       = code->getValue();
+    // Only text with substitutions (i.e. expressions) is likely to come back, plain lists are just data.
+    if (text.find_first_of(L_STR("$[")) != lstring::npos) {
+        INT save_igeol = lil->getIgnoreEol();
+        lil->setIgnoreEol() = true;
+        auto parsed = _find_parsed_code(lil, text.c_str(), code->getValueLen());
+        words = parsed->cmds_.empty() ? lil_alloc_list(lil) : _substitute_words(lil, parsed->cmds_[0]);
+        lil->setIgnoreEol() = save_igeol;
+    } else {
+        words = _split_plain(lil, text);
+    }
     if (!words) { words = lil_alloc_list(lil); }
-    lil->setCode(save_code.c_str(), save_clen, save_head);
-    lil->setIgnoreEol() = save_igeol;
     return words;
 }
 
@@ -588,20 +1125,27 @@ Lil_value_Ptr lil_subst_to_value(LilInterp_Ptr lil, Lil_value_Ptr code) {
 
 // Top level parser.
 Lil_value_Ptr lil_parse(LilInterp_Ptr lil, lcstrp code, INT codelen, INT funclevel) {
-    assert(lil!=nullptr); assert(code!=nullptr);  // #topic parsedCalls, codeLen, parsedDepth, foundCmds, notFoundCmds, numProcCalls
+    assert(lil!=nullptr); assert(code!=nullptr);
+    if (!codelen) { codelen = CAST(Lil::INT)LSTRLEN(code); }
+    auto parsed = _find_parsed_code(lil, code, codelen);
+    return _run_parsed_code(lil, parsed, code, funclevel);
+}
+
+// Run parsed code.
+ND static Lil_value_Ptr _run_parsed_code(LilInterp_Ptr lil, const Lil_parsedCode_Ptr& parsed, lcstrp code, INT funclevel) { // #private
+    assert(lil!=nullptr); assert(parsed!=nullptr); // #topic parsedCalls, codeLen, parsedDepth, foundCmds, notFoundCmds, numProcCalls
     lil->sysInfo_->numEvalCalls_++;
-    auto save_code = lil->getCodeObj();
-    INT           save_clen  = lil->getCodeLen();
-    INT           save_head  = lil->getHead();
+    Lil_codeRestore restore(lil);
     Lil_value_Ptr val        = nullptr;
     Lil_list_Ptr  words      = nullptr;
+    Lil_cmdArena  arena;
 
+    // Only for a parse too deep, return, errors and unknown commands just end the loop. #optimization
     struct lil_parse_exit : std::exception { };
 
     try {
-        if (save_code.empty()) { lil->setRootCode() = code; }
-        lil->setCode(code, codelen ? codelen : CAST(Lil::INT)LSTRLEN(code));
-        _skip_spaces(lil);
+        if (!lil->inCode()) { lil->setRootCode() = code; }
+        lil->pushCode(parsed->code_.c_str(), parsed->codeLen_);
         lil->incrParse_depth(1); // Start new parse level.
         //LPRINTF("DEBUG> code_ %s level %d\n", (std::string(code_, 20).c_str()), lil->getParse_depth());
         if (lil->sysInfo_->limit_ParseDepth_) { // Do we limit recursion? #TODO
@@ -613,129 +1157,670 @@ Lil_value_Ptr lil_parse(LilInterp_Ptr lil, lcstrp code, INT codelen, INT funclev
         }
         if (lil->getParse_depth() == 1) { lil->SETERROR(ErrorCode()); }
         if (funclevel) { lil->getEnv()->setBreakrun() = false; }
-        while (lil->getHead() < lil->getCodeLen() && !lil->getError().inError()) {
-            if (words) { lil_free_list(words); }
+        for (auto& parsedCmd : parsed->cmds_) {
+            if (lil->getError().inError()) { break; }
+            if (words) {
+                lil_free_list(words);
+                arena.release();
+            }
             if (val) { lil_free_value(val); }
             val = nullptr;
 
-            words = _substitute(lil);
-            if (!words || lil->getError().inError()) {
-                throw lil_parse_exit();
+            words = _substitute_words(lil, parsedCmd, &arena);
+            if (!words || lil->getError().inError()) { break; }
+            lil->moveHead(parsedCmd.head_);
+            val = _run_cmd(lil, words, parsedCmd.litName_ ? &parsedCmd.site_ : nullptr);
+
+            if (lil->getEnv()->getBreakrun()) { break; } // A "break-like" command was executed.
+        } // for (auto& parsedCmd : parsed->cmds_)
+    } catch (const lil_parse_exit& lpe) {
+        // Nothing to do.
+        UNUSED(lpe);
+        DBGPRINTF(L_VSTR(0x30b3, "Throw lil_parse_exit exception caught.\n"));
+    }
+
+    if (lil->getError().inError() && lil->getCallback(LIL_CALLBACK_ERROR) && lil->getParse_depth() == 1) {
+        // Got to top with "break-like" command and run callback to handle that.
+        auto proc = (lil_error_callback_proc_t) lil->getCallback(LIL_CALLBACK_ERROR);
+        proc(lil, lil->getErr_head(), lil->getErrMsg().c_str());
+    }
+    if (words) { lil_free_list(words); }
+    lil->popCode(restore.depth_); // Restore code to original.
+    if (funclevel && lil->getEnv()->getRetval_set()) { // Handle return value.
+        if (val) { lil_free_value(val); }
+        val = lil->getEnv()->getReturnVal();
+        lil->getEnv()->setReturnVal() = nullptr;
+        lil->getEnv()->setRetval_set() = false;
+        lil->getEnv()->setBreakrun()   = false;
+    }
+    lil->incrParse_depth(-1); // Done with this parse level.
+    return val ? val : new Lil_value(lil); // Return value or nullptr.
+}
+
+// Run "proc" command cmd called with words in its new callframe.  Called from _run_cmd()
+ND static Lil_value_Ptr _run_func_in_env(LilInterp_Ptr lil, Lil_func_Ptr cmd, Lil_list_Ptr words) { // #private
+    assert(lil!=nullptr); assert(cmd!=nullptr); assert(words!=nullptr);
+    lil->sysInfo_->numProcsRuns_++;
+    lil->getEnv()->setFunc() = cmd; // Set this callframe function.
+    if (lil->sysInfo_->funcBytecode_ && !lil->getIgnoreEol() && cmd->getCode() && cmd->getCode()->getValueLen()) {
+        auto bc = _find_func_bytecode(lil, cmd); // Same as _run_func_body() will run.
+        if (!bc->fallback_ && bc->slotNames_) { lil->getEnv()->setSlots(bc->slotNames_); }
+    }
+    if (!cmd->getArgnames()->getCount()) {
+        // #TODO what if no args? #FIXME
+        // Handling of variable number of arguments.
+        Lil_value_SPtr args(lil_list_to_value(lil, words, true)); // Delete on exit.
+        lil_set_var(lil, L_STR("args"), args.v, LIL_SETVAR_LOCAL_NEW);
+    } else {
+        auto& elem0 = cmd->getArgnames()->getValue(0)->getValue(); // #TODO cmd->getArgnames()->getValue(0)->getValue() implies numArgs > 0
+        if (cmd->getArgnames()->getCount() == 1 && (elem0 == L_STR("args"))) {
+            // Handling of variable number of arguments.
+            Lil_value_SPtr args(lil_list_to_value(lil, words, true)); // Delete on exit.
+            lil_set_var(lil, L_STR("args"), args.v, LIL_SETVAR_LOCAL_NEW);
+        } else { // Handling of fix number of arguments.
+            for (INT i = 0; i <
+                cmd->getArgnames()->getCount(); i++) { // Create named argument for each positional argument.
+                lil_set_var(lil, lil_to_string(cmd->getArgnames()->getValue(i)),
+                    i < words->getCount() - 1 ? words->getValue(i + 1) : lil->getEmptyVal(),
+                    LIL_SETVAR_LOCAL_NEW);
             }
+        }
+    }
+    if (!cmd->getCode() || !cmd->getCode()->getValueLen()) {
+        return new Lil_value(lil);
+    }
+    return _run_func_body(lil, cmd); // Actually func command.
+}
 
-            if (words->getCount()) {
-                Lil_func_Ptr cmd = _find_cmd(lil, words->getValue(0)->getValue().c_str()); // Try dispatch on first word.
-                if (!cmd) { // Found a command.
-                    lil->sysInfo_->numNonFoundCommands_++;
-                    if (words->getValue(0)->getValueLen()) {
-                        if (lil->isCatcherEmpty()) {
-                            if (lil->getIn_catcher() < lil->sysInfo_->limit_ParseDepth_) { // #topic
-                                lil->incr_in_catcher(true);
-                                {
-                                    lil_push_env(lil);
-                                    {
-                                        lil->getEnv()->setCatcher_for(words->getValue(0));
-                                        Lil_value_SPtr args(lil_list_to_value(lil, words, true)); // Delete on exit.
-                                        lil_set_var(lil, L_STR("args"), args.v, LIL_SETVAR_LOCAL_NEW);
-                                        val = lil_parse(lil, lil->getCatcher().c_str(), 0, 1);
-                                    }
-                                    lil_pop_env(lil);
-                                }
-                                lil->incr_in_catcher(-1);
-                            } else {
-                                std::vector <lchar> msg(CAST(size_t)(words->getValue(0)->getValueLen() + 64), LC('\0')); // #magic
-                                LSPRINTF(&msg[0], L_VSTR(0xace4,
-                                                         "catcher limit reached while trying to call unknown function %s"),
-                                         words->getValue(0)->getValue().c_str());
-                                lil_set_error_at(lil, lil->getHead(), &msg[0]); // #INTERP_ERR
-                                throw lil_parse_exit();
+// Run a command from its substituted words, dispatch on first word.  If site isn't nullptr the first word is always
+// the same literal, so the command found there is used.  Called from _run_parsed_code(), Lil_vm::call()
+ND static Lil_value_Ptr _run_cmd(LilInterp_Ptr lil, Lil_list_Ptr words, Lil_cmdSite* site) { // #private
+    assert(lil!=nullptr); assert(words!=nullptr); // #topic foundCmds, notFoundCmds, numProcCalls
+    Lil_value_Ptr val = nullptr;
+
+    if (words->getCount()) {
+        auto&        name = words->getValue(0)->getValue();
+        Lil_func_Ptr cmd  = site ? lil->find_cmd(name, *site) : lil->find_cmd(name); // Try dispatch on first word.
+        if (!cmd) { // Found a command.
+            lil->sysInfo_->numNonFoundCommands_++;
+            if (words->getValue(0)->getValueLen()) {
+                if (lil->isCatcherEmpty()) {
+                    if (lil->getIn_catcher() < lil->sysInfo_->limit_ParseDepth_) { // #topic
+                        lil->incr_in_catcher(true);
+                        {
+                            lil_push_env(lil);
+                            {
+                                lil->getEnv()->setCatcher_for(words->getValue(0));
+                                Lil_value_SPtr args(lil_list_to_value(lil, words, true)); // Delete on exit.
+                                lil_set_var(lil, L_STR("args"), args.v, LIL_SETVAR_LOCAL_NEW);
+                                val = lil_parse(lil, lil->getCatcher().c_str(), 0, 1);
                             }
-                        } else {
-                            std::vector <lchar> msg(CAST(size_t)(words->getValue(0)->getValueLen() + 32), LC('\0')); // #magic
-                            LSPRINTF(&msg[0], L_VSTR(0xef08, "unknown function %s"), words->getValue(0)->getValue().c_str());
-                            lil_set_error_at(lil, lil->getHead(), &msg[0]); // #INTERP_ERR
-                            throw lil_parse_exit();
+                            lil_pop_env(lil);
                         }
-                    } // if (words->getValue(0)->getValueLen())
-                } // if (!cmdArray_)
-                if (cmd) { // Got a command.
-                    if (cmd->getProc()) { // Got a "binary" command.
-                        lil->sysInfo_->numCommandsRun_++;
-                        INT currCodeOffset = lil->getHead();
-                        try {
+                        lil->incr_in_catcher(-1);
+                    } else {
+                        std::vector <lchar> msg(CAST(size_t)(words->getValue(0)->getValueLen() + 64), LC('\0')); // #magic
+                        LSPRINTF(&msg[0], L_VSTR(0xace4,
+                                                 "catcher limit reached while trying to call unknown function %s"),
+                                 words->getValue(0)->getValue().c_str());
+                        lil_set_error_at(lil, lil->getHead(), &msg[0]); // #INTERP_ERR
+                        return nullptr; // #ERR_RET
+                    }
+                } else {
+                    std::vector <lchar> msg(CAST(size_t)(words->getValue(0)->getValueLen() + 32), LC('\0')); // #magic
+                    LSPRINTF(&msg[0], L_VSTR(0xef08, "unknown function %s"), words->getValue(0)->getValue().c_str());
+                    lil_set_error_at(lil, lil->getHead(), &msg[0]); // #INTERP_ERR
+                    return nullptr; // #ERR_RET
+                }
+            } // if (words->getValue(0)->getValueLen())
+        } // if (!cmdArray_)
+        if (cmd) { // Got a command.
+            if (cmd->isProc()) { // Got a "binary" command.
+                lil->sysInfo_->numCommandsRun_++;
+                INT currCodeOffset = lil->getHead();
+                try {
 #ifdef LIL_LIST_IS_ARRAY
-                            val = cmd->getProc()(lil, CAST(ARGINT)(words->getCount() - 1), words->getArgs());
+                    val = cmd->callProc(lil, CAST(ARGINT)(words->getCount() - 1), words->getArgs());
 #else
-                            // Call our command function pointer.
-                            std::vector<Lil_value_Ptr> listRep;
-                            words->convertListToArrayForArgs(listRep);
-                            val          = cmd->getProc()(lil, words->getCount() - 1, &listRep[0]);
+                    // Call our command function pointer.
+                    std::vector<Lil_value_Ptr> listRep;
+                    words->convertListToArrayForArgs(listRep);
+                    val          = cmd->callProc(lil, words->getCount() - 1, &listRep[0]);
 #endif
-                        } catch (std::exception& ex) {
-                            // Command threw an exception
-                            lil->sysInfo_->numExceptionsInCommands_++;
-                            printf(L_VSTR(0x2b43, "ERROR: Command threw exception: cmd %s type: %s msg %s\n"),
-                                   words->getValue(0)->getValue().c_str(), typeid(ex).name(), ex.what());
-                            // #TODO: make this conditional so C++ commands can use this to signal errors.
-                            throw; // Rethrow the exception.
-                        }
+                } catch (std::exception& ex) {
+                    // Command threw an exception
+                    lil->sysInfo_->numExceptionsInCommands_++;
+                    printf(L_VSTR(0x2b43, "ERROR: Command threw exception: cmd %s type: %s msg %s\n"),
+                           words->getValue(0)->getValue().c_str(), typeid(ex).name(), ex.what());
+                    // #TODO: make this conditional so C++ commands can use this to signal errors.
+                    throw; // Rethrow the exception.
+                }
 
-                        if (lil->getError().val() == ERROR_FIXHEAD) {
-                            lil->setError(LIL_ERROR(ERROR_DEFAULT), currCodeOffset);
+                if (lil->getError().val() == ERROR_FIXHEAD) {
+                    lil->setError(LIL_ERROR(ERROR_DEFAULT), currCodeOffset);
+                }
+            } else { // Got a "proc" command.
+                lil_push_env(lil); // Add new callframe.
+                val = _run_func_in_env(lil, cmd, words);
+                // A "tailcall" of a func runs it in this callframe instead of deeper in the stack. #optimization
+                Lil_list_Ptr tailWords = nullptr;
+                while ((tailWords = lil->getEnv()->takeTailCall()) != nullptr && !lil->getError().inError()) {
+                    Lil_func_Ptr      next = lil->find_cmd(tailWords->getValue(0)->getValue());
+                    Lil_callframe_Ptr env  = lil->getEnv();
+                    lil_free_value(val);
+                    if (next && !next->isProc()) {
+                        lil->sysInfo_->numTailCalls_++;
+                        Lil_callframe_Ptr parent = env->getParent();
+                        env->retire();
+                        env->reuse(parent);
+                        val = _run_func_in_env(lil, next, tailWords);
+                    } else { // Anything else ends the func, so "return" and "upeval" in it are the func's.
+                        env->setBreakrun() = false;
+                        val = _run_cmd(lil, tailWords, nullptr);
+                        if (env->getRetval_set()) { // As _run_parsed_code() does for a func.
+                            lil_free_value(val);
+                            val = env->getReturnVal();
+                            env->setReturnVal()  = nullptr;
+                            env->setRetval_set() = false;
+                            env->setBreakrun()   = false;
                         }
-                    } else { // Got a "proc" command.
-                        lil->sysInfo_->numProcsRuns_++;
-                        lil_push_env(lil); // Add new callframe.
-                        lil->getEnv()->setFunc() = cmd; // Set this callframe function.
-                        if (!cmd->getArgnames()->getCount()) {
-                            // #TODO what if no args? #FIXME
-                            // Handling of variable number of arguments.
-                            Lil_value_SPtr args(lil_list_to_value(lil, words, true)); // Delete on exit.
-                            lil_set_var(lil, L_STR("args"), args.v, LIL_SETVAR_LOCAL_NEW);
-                        } else {
-                            auto& elem0 = cmd->getArgnames()->getValue(0)->getValue(); // #TODO cmd->getArgnames()->getValue(0)->getValue() implies numArgs > 0
-                            if (cmd->getArgnames()->getCount() == 1 && (elem0 == L_STR("args"))) {
-                                // Handling of variable number of arguments.
-                                Lil_value_SPtr args(lil_list_to_value(lil, words, true)); // Delete on exit.
-                                lil_set_var(lil, L_STR("args"), args.v, LIL_SETVAR_LOCAL_NEW);
-                            } else { // Handling of fix number of arguments.
-                                for (INT i = 0; i <
-                                    cmd->getArgnames()->getCount(); i++) { // Create named argument for each positional argument.
-                                    lil_set_var(lil, lil_to_string(cmd->getArgnames()->getValue(i)),
-                                        i < words->getCount() - 1 ? words->getValue(i + 1) : lil->getEmptyVal(),
-                                        LIL_SETVAR_LOCAL_NEW);
-                                }
-                            }
-                        } 
-                        val                      = lil_parse_value(lil, cmd->getCode(), 1); // Actually func command.
-                        lil_pop_env(lil); // Pop functions callframe.
                     }
-                } // if (cmdArray_)
-            } // if (words->getCount())
+                    lil_free_list(tailWords);
+                }
+                if (tailWords) { lil_free_list(tailWords); } // Left by an error.
+                lil_pop_env(lil); // Pop functions callframe.
+            }
+        } // if (cmdArray_)
+    } // if (words->getCount())
+    return val;
+}
 
-            if (lil->getEnv()->getBreakrun()) {
-                throw lil_parse_exit();
-            } // A "break-like" command was executed.
+// Compiles parsed code of a func body into Lil_bytecode.  Commands that aren't done inline are compiled to their words
+// and LIL_OP_CALL, anything else it can't handle is left to _eval_part().
+struct Lil_compiler { // #class #private
+    using WordRange = std::pair<size_t, size_t>; // Parts of a word [first, last).
+    static const INT MAX_DEPTH = 64; // #magic
 
-            // Continue past any "junk" at end of command.
-            _skip_spaces(lil);
-            while (_ateol(lil)) lil->incrHead(1);
-            _skip_spaces(lil);
-        } // while (lil->getHead() < lil->getCodeLen() && !lil->getError())
-    } catch (const lil_parse_exit& lpe) {
-        // Nothing to do.
-        UNUSED(lpe);
-        DBGPRINTF(L_VSTR(0x30b3, "Throw lil_parse_exit exception caught.\n"));
+    LilInterp_Ptr lil_;
+    Lil_bytecode& bc_;
+    INT           depth_ = 0; // Nesting of blocks compiled inline.
+
+    Lil_compiler(LilInterp_Ptr lil, Lil_bytecode& bc) : lil_(lil), bc_(bc) { } // #ctor
+
+    ND INT here() const { return CAST(INT)bc_.ops_.size(); }
+    INT emit(LIL_OPCODE op, INT a = 0, INT b = 0, INT c = 0) {
+        bc_.ops_.push_back(Lil_op{op, a, b, c});
+        return here() - 1;
+    }
+    ND INT addLit(lstring_view text) {
+        bc_.lits_.emplace_back(text);
+        return CAST(INT)bc_.lits_.size() - 1;
+    }
+    ND INT addExpr(lstring_view text) {
+        bc_.exprs_.push_back(new Lil_value(lil_, text));
+        return CAST(INT)bc_.exprs_.size() - 1;
+    }
+    ND INT addPart(Lil_parsedPart& part) {
+        bc_.parts_.push_back(&part);
+        return CAST(INT)bc_.parts_.size() - 1;
+    }
+    // Index of call site of command or -1 if its name isn't literal.
+    ND INT addSite(Lil_parsedCmd& cmd) {
+        if (!cmd.litName_) { return -1; }
+        bc_.sites_.push_back(&cmd.site_);
+        return CAST(INT)bc_.sites_.size() - 1;
+    }
+    ND INT addCode(const Lil_parsedCode_Ptr& parsed) {
+        bc_.codes_.push_back(parsed);
+        return CAST(INT)bc_.codes_.size() - 1;
+    }
+    // Index of builtin command or -1 if there is no such builtin.
+    ND INT addBuiltin(lcstrp name) {
+        for (size_t i = 0; i < bc_.builtins_.size(); i++) {
+            if (bc_.builtins_[i].first == name) { return CAST(INT)i; }
+        }
+        auto func = lil_->find_sys_cmd(name);
+        if (!func) { return -1; }
+        bc_.builtins_.emplace_back(name, func);
+        bc_.builtinSites_.emplace_back();
+        return CAST(INT)bc_.builtins_.size() - 1;
+    }
+    // Index of counted loop for cond (and step) or -1 if it isn't one.
+    ND INT addCounted(lstring_view cond, std::optional<lstring_view> step) {
+        Lil_countedLoop loop;
+        if (!_match_counted_cond(cond, loop) || (step && !_match_counted_step(*step, loop))) { return -1; }
+        loop.setBuiltin_  = addBuiltin(L_STR("set"));
+        loop.stepBuiltin_ = step ? addBuiltin(loop.stepCmd_.c_str()) : -1;
+        if (loop.setBuiltin_ < 0 || (step && loop.stepBuiltin_ < 0)) { return -1; }
+        bc_.counted_.push_back(std::move(loop));
+        return CAST(INT)bc_.counted_.size() - 1;
+    }
+
+    // Word that is just a literal or nothing.
+    ND static std::optional<lstring_view> literal(const Lil_parsedCmd& cmd, const WordRange& w) {
+        auto& part = cmd.parts_[w.first];
+        if (w.second - w.first == 1 && part.type_ == LIL_PART_LITERAL) { return part.text(); }
+        return std::nullopt;
+    }
+    // Parse code of a block, nullptr if a parse error stops it part way (leave that to the text interpreter).
+    ND Lil_parsedCode_Ptr parseBlock(lstring_view text) {
+        if (depth_ >= MAX_DEPTH) { return nullptr; }
+        auto parsed = _parse_code(lil_, text.data(), CAST(INT)text.length());
+        for (auto& cmd : parsed->cmds_) {
+            if (cmd.parseError_) { return nullptr; }
+        }
+        return parsed;
+    }
+
+    void block(Lil_parsedCode& parsed) {
+        for (auto& cmd : parsed.cmds_) { command(cmd); }
+    }
+    // Block run like lil_parse() would, with its own code and parse depth.
+    void enterBlock(const Lil_parsedCode_Ptr& parsed, LIL_OPCODE leave) {
+        INT enter = emit(LIL_OP_ENTER, addCode(parsed));
+        depth_++;
+        block(*parsed);
+        depth_--;
+        bc_.ops_[CAST(size_t)enter].b_ = emit(leave);
+    }
+    // Code of a brace word, like lil_parse_value() empty code is not run.
+    void bodyBlock(lstring_view text, const Lil_parsedCode_Ptr& parsed) {
+        if (!text.empty()) { enterBlock(parsed, LIL_OP_LEAVE); }
+    }
+
+    void part(Lil_parsedPart& part) {
+        switch (part.type_) {
+            case LIL_PART_LITERAL:
+                emit(LIL_OP_PUSH_LIT, addLit(part.text()));
+                break;
+            case LIL_PART_BRACKET: {
+                if (part.src_.empty()) { emit(LIL_OP_PUSH_LIT, addLit(part.src_)); break; }
+                if (!part.code_) { part.code_ = _parse_code(lil_, part.src_.data(), CAST(INT)part.src_.length()); }
+                bool ok = depth_ < MAX_DEPTH;
+                for (auto& cmd : part.code_->cmds_) { ok = ok && !cmd.parseError_; }
+                if (ok) { enterBlock(part.code_, LIL_OP_LEAVE_WORD); }
+                else { emit(LIL_OP_PUSH_PART, addPart(part)); }
+                break;
+            }
+            case LIL_PART_DOLLAR: {
+                auto& name    = part.parts_[0];
+                INT   builtin = addBuiltin(L_STR("set"));
+                if (name.type_ == LIL_PART_LITERAL && _is_plain_name(name.text()) && builtin >= 0) {
+                    emit(LIL_OP_LOAD_VAR, addLit(name.text()), addPart(part), builtin);
+                } else {
+                    emit(LIL_OP_PUSH_PART, addPart(part));
+                }
+                break;
+            }
+            case LIL_PART_QUOTE:
+                for (auto& qp : part.parts_) { this->part(qp); }
+                if (part.parts_.size() != 1) { emit(LIL_OP_APPEND, CAST(INT)part.parts_.size()); }
+                break;
+            default:
+                emit(LIL_OP_PUSH_PART, addPart(part));
+                break;
+        }
+    }
+    void word(Lil_parsedCmd& cmd, const WordRange& w) {
+        for (size_t i = w.first; i < w.second; i++) { part(cmd.parts_[i]); }
+        if (w.second - w.first != 1) { emit(LIL_OP_APPEND, CAST(INT)(w.second - w.first)); }
+    }
+    void call(Lil_parsedCmd& cmd, const std::vector<WordRange>& words) {
+        for (auto& w : words) { word(cmd, w); }
+        emit(LIL_OP_CALL, CAST(INT)words.size(), cmd.head_, addSite(cmd));
+    }
+
+    void command(Lil_parsedCmd& cmd) {
+        std::vector<WordRange> words;
+        for (size_t i = 0; i < cmd.parts_.size(); i++) {
+            if (cmd.parts_[i].wordStart_ || words.empty()) { words.emplace_back(i, i + 1); }
+            else { words.back().second = i + 1; }
+        }
+        emit(LIL_OP_CMD);
+        auto name = words.empty() ? std::nullopt : literal(cmd, words[0]);
+        bool done = false;
+        if (name) {
+            if (*name == L_STR("set"))          { done = inlineSet(cmd, words); }
+            else if (*name == L_STR("if"))      { done = inlineIf(cmd, words); }
+            else if (*name == L_STR("while"))   { done = inlineWhile(cmd, words); }
+            else if (*name == L_STR("for"))     { done = inlineFor(cmd, words); }
+            else if (*name == L_STR("foreach")) { done = inlineForeach(cmd, words); }
+        }
+        if (!done) { call(cmd, words); }
+        emit(LIL_OP_END_CMD);
+    }
+
+    // set <name> <value>
+    ND bool inlineSet(Lil_parsedCmd& cmd, const std::vector<WordRange>& words) {
+        if (words.size() != 3) { return false; }
+        auto name    = literal(cmd, words[1]);
+        INT  builtin = addBuiltin(L_STR("set"));
+        if (!name || *name == L_STR("global") || builtin < 0) { return false; }
+        word(cmd, words[2]);
+        emit(LIL_OP_STORE_VAR, addLit(*name), cmd.head_, builtin);
+        return true;
     }
 
+    // Skip "bnot_" option of if/while, returns index of expression word.
+    ND static size_t condWord(const Lil_parsedCmd& cmd, const std::vector<WordRange>& words, bool& bnot) {
+        auto first = literal(cmd, words[1]);
+        bnot = first && *first == L_STR("bnot_");
+        return bnot ? 2 : 1;
+    }
+
+    // if ["bnot_"] <expr> <code> [else-code]
+    ND bool inlineIf(Lil_parsedCmd& cmd, const std::vector<WordRange>& words) {
+        if (words.size() < 3) { return false; }
+        bool   bnot;
+        size_t ci = condWord(cmd, words, bnot);
+        if (words.size() != ci + 2 && words.size() != ci + 3) { return false; }
+        auto cond     = literal(cmd, words[ci]);
+        auto thenCode = literal(cmd, words[ci + 1]);
+        auto elseCode = words.size() == ci + 3 ? literal(cmd, words[ci + 2]) : std::nullopt;
+        if (!cond || !thenCode || (words.size() == ci + 3 && !elseCode)) { return false; }
+        auto thenBlock = parseBlock(*thenCode);
+        auto elseBlock = elseCode ? parseBlock(*elseCode) : nullptr;
+        INT  builtin   = addBuiltin(L_STR("if"));
+        if (!thenBlock || (elseCode && !elseBlock) || builtin < 0) { return false; }
+
+        INT guard = emit(LIL_OP_GUARD, builtin);
+        emit(LIL_OP_HEAD, cmd.head_);
+        INT test = emit(bnot ? LIL_OP_JUMP_TRUE : LIL_OP_JUMP_FALSE, addExpr(*cond));
+        bodyBlock(*thenCode, thenBlock);
+        INT skip = emit(LIL_OP_JUMP);
+        bc_.ops_[CAST(size_t)test].b_ = here();
+        if (elseCode) { bodyBlock(*elseCode, elseBlock); }
+        INT fin = emit(LIL_OP_BUILTIN_END);
+        bc_.ops_[CAST(size_t)test].c_ = bc_.ops_[CAST(size_t)skip].a_ = fin;
+        INT done = emit(LIL_OP_JUMP);
+        bc_.ops_[CAST(size_t)guard].b_ = here();
+        call(cmd, words);
+        bc_.ops_[CAST(size_t)done].a_ = here();
+        return true;
+    }
+
+    // Loop tail shared by while/for, fail is where expression errors go.
+    void loopEnd(INT top, INT check, INT test) {
+        emit(LIL_OP_JUMP, top);
+        INT fail = emit(LIL_OP_LOOP_END, 1);
+        INT skip = emit(LIL_OP_JUMP);
+        INT end  = emit(LIL_OP_LOOP_END, 0);
+        bc_.ops_[CAST(size_t)check].a_ = bc_.ops_[CAST(size_t)test].b_ = end;
+        bc_.ops_[CAST(size_t)test].c_  = fail;
+        bc_.ops_[CAST(size_t)skip].a_  = emit(LIL_OP_BUILTIN_END);
+    }
+    // Condition of counted loop a_ tried before the expression test, set its jumps once the loop is done.
+    void countedEnd(INT count, INT test, INT body, bool bnot) {
+        if (count < 0) { return; }
+        INT end = bc_.ops_[CAST(size_t)test].b_;
+        bc_.ops_[CAST(size_t)count].b_ = bnot ? body : end;
+        bc_.ops_[CAST(size_t)count].c_ = bnot ? end : body;
+    }
+    // Jump over the generic call of a guarded inline command.
+    void guardEnd(Lil_parsedCmd& cmd, const std::vector<WordRange>& words, INT guard) {
+        INT done = emit(LIL_OP_JUMP);
+        bc_.ops_[CAST(size_t)guard].b_ = here();
+        call(cmd, words);
+        bc_.ops_[CAST(size_t)done].a_ = here();
+    }
+
+    // while ["bnot_"] <expr> <code>
+    ND bool inlineWhile(Lil_parsedCmd& cmd, const std::vector<WordRange>& words) {
+        if (words.size() < 3) { return false; }
+        bool   bnot;
+        size_t ci = condWord(cmd, words, bnot);
+        if (words.size() != ci + 2) { return false; }
+        auto cond = literal(cmd, words[ci]);
+        auto code = literal(cmd, words[ci + 1]);
+        if (!cond || !code) { return false; }
+        auto body    = parseBlock(*code);
+        INT  builtin = addBuiltin(L_STR("while"));
+        if (!body || builtin < 0) { return false; }
+
+        INT guard   = emit(LIL_OP_GUARD, builtin);
+        INT counted = addCounted(*cond, std::nullopt);
+        emit(LIL_OP_HEAD, cmd.head_);
+        emit(LIL_OP_LOOP);
+        INT top   = emit(LIL_OP_LOOP_CHECK);
+        INT count = counted < 0 ? -1 : emit(LIL_OP_COUNT_TEST, counted);
+        INT test  = emit(bnot ? LIL_OP_JUMP_TRUE : LIL_OP_JUMP_FALSE, addExpr(*cond));
+        INT start = emit(LIL_OP_LOOP_BODY);
+        bodyBlock(*code, body);
+        emit(LIL_OP_LOOP_KEEP);
+        loopEnd(top, top, test);
+        countedEnd(count, test, start, bnot);
+        guardEnd(cmd, words, guard);
+        return true;
+    }
+
+    // for <init> <expr> <step> <code>
+    ND bool inlineFor(Lil_parsedCmd& cmd, const std::vector<WordRange>& words) {
+        if (words.size() != 5) { return false; }
+        auto init = literal(cmd, words[1]);
+        auto cond = literal(cmd, words[2]);
+        auto step = literal(cmd, words[3]);
+        auto code = literal(cmd, words[4]);
+        if (!init || !cond || !step || !code) { return false; }
+        auto initBlock = parseBlock(*init);
+        auto stepBlock = parseBlock(*step);
+        auto body      = parseBlock(*code);
+        INT  builtin   = addBuiltin(L_STR("for"));
+        if (!initBlock || !stepBlock || !body || builtin < 0) { return false; }
+
+        INT guard   = emit(LIL_OP_GUARD, builtin);
+        INT counted = addCounted(*cond, *step);
+        emit(LIL_OP_HEAD, cmd.head_);
+        bodyBlock(*init, initBlock);
+        emit(LIL_OP_DROP);
+        emit(LIL_OP_LOOP);
+        INT top   = emit(LIL_OP_LOOP_CHECK);
+        INT count = counted < 0 ? -1 : emit(LIL_OP_COUNT_TEST, counted);
+        INT test  = emit(LIL_OP_JUMP_FALSE, addExpr(*cond));
+        INT start = emit(LIL_OP_LOOP_BODY);
+        bodyBlock(*code, body);
+        emit(LIL_OP_LOOP_KEEP);
+        INT stepped = counted < 0 ? -1 : emit(LIL_OP_COUNT_STEP, counted);
+        bodyBlock(*step, stepBlock);
+        emit(LIL_OP_DROP);
+        if (stepped >= 0) { bc_.ops_[CAST(size_t)stepped].b_ = here(); }
+        loopEnd(top, top, test);
+        countedEnd(count, test, start, false);
+        guardEnd(cmd, words, guard);
+        return true;
+    }
+
+    // foreach [name] <list> <code>
+    ND bool inlineForeach(Lil_parsedCmd& cmd, const std::vector<WordRange>& words) {
+        if (words.size() != 3 && words.size() != 4) { return false; }
+        auto code = literal(cmd, words.back());
+        if (!code) { return false; }
+        auto body    = parseBlock(*code);
+        INT  builtin = addBuiltin(L_STR("foreach"));
+        if (!body || builtin < 0) { return false; }
+
+        // Words are on the stack before we know if it's still the builtin, the generic call takes them from there.
+        for (auto& w : words) { word(cmd, w); }
+        emit(LIL_OP_HEAD, cmd.head_);
+        INT start = emit(LIL_OP_FOREACH, CAST(INT)words.size(), 0, builtin);
+        INT next  = emit(LIL_OP_FOREACH_NEXT);
+        bodyBlock(*code, body);
+        INT keep = emit(LIL_OP_FOREACH_KEEP, 0, next);
+        INT end  = emit(LIL_OP_FOREACH_END);
+        bc_.ops_[CAST(size_t)next].a_ = bc_.ops_[CAST(size_t)keep].a_ = end;
+        emit(LIL_OP_BUILTIN_END);
+        INT done = emit(LIL_OP_JUMP);
+        bc_.ops_[CAST(size_t)start].b_ = emit(LIL_OP_CALL, CAST(INT)words.size(), cmd.head_, addSite(cmd));
+        bc_.ops_[CAST(size_t)done].a_  = here();
+        return true;
+    }
+};
+
+// Give the arguments and the variables the body reads or sets by literal name slots in the callframe.
+// Called from _compile_func()
+static void _layout_slots(LilInterp_Ptr lil, Lil_bytecode& bc, Lil_func_Ptr cmd) { // #private
+    auto& symbols = lil->getSymbols();
+    auto  names   = std::make_shared<std::vector<Lil_symRef>>();
+    auto  add     = [&](const lstring& nameD) {
+        Lil_symRef name = symbols.intern(nameD);
+        if (std::ssize(*names) < Lil_bytecode::MAX_SLOTS && std::find(names->begin(), names->end(), name) == names->end()) {
+            names->push_back(name);
+        }
+    };
+    auto argnames = cmd->getArgnames();
+    if (!argnames || !argnames->getCount()) { add(L_STR("args")); }
+    for (INT i = 0; argnames && i < argnames->getCount(); i++) { add(argnames->getValue(i)->getValue()); }
+    for (auto& op : bc.ops_) {
+        if (op.op_ == LIL_OP_LOAD_VAR || op.op_ == LIL_OP_STORE_VAR) { add(bc.lits_[CAST(size_t)op.a_]); }
+    }
+    bc.litSlots_.assign(bc.lits_.size(), -1);
+    for (auto& op : bc.ops_) {
+        if (op.op_ == LIL_OP_LOAD_VAR || op.op_ == LIL_OP_STORE_VAR) {
+            auto it = std::find(names->begin(), names->end(), symbols.find(bc.lits_[CAST(size_t)op.a_]));
+            if (it != names->end()) { bc.litSlots_[CAST(size_t)op.a_] = CAST(INT)(it - names->begin()); }
+        }
+    }
+    if (!names->empty()) { bc.slotNames_ = names; }
+}
+
+// Compile body of a "proc" command, on parse errors it's marked to run the text way.
+ND static Lil_bytecode_Ptr _compile_func(LilInterp_Ptr lil, Lil_func_Ptr cmd) { // #private
+    assert(lil!=nullptr); assert(cmd!=nullptr); assert(!lil->getIgnoreEol());
+    auto bc   = std::make_shared<Lil_bytecode>();
+    auto body = _find_func_parsed_code(lil, cmd);
+    bc->codes_.push_back(body);
+    for (auto& parsedCmd : body->cmds_) {
+        if (parsedCmd.parseError_) { bc->fallback_ = true; }
+    }
+    if (bc->fallback_) {
+        lil->sysInfo_->numBytecodeFallbacks_++;
+        return bc;
+    }
+    Lil_compiler(lil, *bc).block(*body);
+    _layout_slots(lil, *bc, cmd);
+    lil->sysInfo_->numBytecodeCompiles_++;
+    return bc;
+}
+
+// Get compiled body of a "proc" command, it's kept with the function until the code changes.
+ND static Lil_bytecode_Ptr _find_func_bytecode(LilInterp_Ptr lil, Lil_func_Ptr cmd) { // #private
+    assert(lil!=nullptr); assert(cmd!=nullptr);
+    auto bc = cmd->getBytecode();
+    if (!bc) {
+        bc = _compile_func(lil, cmd);
+        cmd->setBytecode(bc);
+    }
+    return bc;
+}
+
+struct Lil_vmFrame { // #class #private
+    INT    end_;  // Op that ends the block.
+    size_t base_; // Words on the stack when block started.
+    INT    code_; // Code of the block in Lil_bytecode::codes_.
+};
+
+struct Lil_vmLoop { // #class #private
+    Lil_value_Ptr r_     = nullptr; // Last result of while/for body.
+    Lil_listRep_Ptr list_;          // foreach items.
+    Lil_list_Ptr  rlist_ = nullptr; // foreach results.
+    INT           idx_   = 0;
+    lstring       var_;
+};
+
+// State of one run of a compiled func body, see _run_bytecode().  step() runs one op with pc_ already on the next op,
+// a jump changes pc_.
+struct Lil_vm { // #class #private
+    LilInterp_Ptr              lil_;
+    Lil_bytecode&              bc_;
+    Lil_value_Ptr              val_   = nullptr; // Result of last command.
+    INT                        pc_    = 0;
+    std::vector<Lil_value_Ptr> stack_;  // Words of commands being built.
+    std::vector<Lil_vmFrame>   frames_; // Blocks being run, frames_[0] is the body.
+    std::vector<Lil_vmLoop>    loops_;  // Loops being run.
+    Lil_cmdArena               arena_;  // Words lists of LIL_OP_CALL.
+    size_t                     codeDepth_; // Code depth to go back to.
+
+    Lil_vm(LilInterp_Ptr lil, Lil_bytecode& bc, lcstrp code);
+    ~Lil_vm(); // #dtor
+    Lil_vm(const Lil_vm&) = delete;
+    Lil_vm& operator=(const Lil_vm&) = delete;
+    // End the run, result is the return value or the result of the last command.
+    ND Lil_value_Ptr finish();
+    // Run op.
+    void step(const Lil_op& op);
+private:
+    void cmd();
+    void endCmd();
+    void head(const Lil_op& op);
+    void pushLit(const Lil_op& op);
+    void pushPart(const Lil_op& op);
+    void loadVar(const Lil_op& op);
+    void append(const Lil_op& op);
+    void call(const Lil_op& op);
+    void storeVar(const Lil_op& op);
+    void guard(const Lil_op& op);
+    void enter(const Lil_op& op);
+    void leave(const Lil_op& op); // LIL_OP_LEAVE and LIL_OP_LEAVE_WORD.
+    void drop();
+    void jump(const Lil_op& op);
+    void jumpIf(const Lil_op& op); // LIL_OP_JUMP_FALSE and LIL_OP_JUMP_TRUE.
+    void loop();
+    void loopCheck(const Lil_op& op);
+    void loopBody();
+    void loopKeep();
+    void loopEnd(const Lil_op& op);
+    void foreach(const Lil_op& op);
+    void foreachNext(const Lil_op& op);
+    void foreachKeep(const Lil_op& op);
+    void foreachEnd();
+    void builtinEnd();
+    void countTest(const Lil_op& op);
+    void countStep(const Lil_op& op);
+    void abortCmd();
+    ND bool isBuiltin(INT builtin);
+    ND Lil_var_Ptr slotVar(INT lit);
+    void fixErrorHead();
+};
+
+// Run compiled body of a "proc" command, does what _run_parsed_code() does with funclevel 1.
+ND static Lil_value_Ptr _run_bytecode(LilInterp_Ptr lil, const Lil_bytecode_Ptr& bc, lcstrp code) { // #private
+    assert(lil!=nullptr); assert(bc!=nullptr); assert(code!=nullptr);
+    lil->sysInfo_->numEvalCalls_++;
+    lil->sysInfo_->numBytecodeRuns_++;
+    Lil_vm vm(lil, *bc, code);
+    auto&  ops = bc->ops_;
+    while (vm.pc_ < CAST(INT)ops.size()) { vm.step(ops[CAST(size_t)vm.pc_++]); }
+    return vm.finish();
+}
+
+Lil_vm::Lil_vm(LilInterp_Ptr lil, Lil_bytecode& bc, lcstrp code) // #ctor
+    : lil_(lil), bc_(bc), codeDepth_(lil->getCodeDepth()) {
+    auto& body = bc_.codes_[0];
+    if (!lil_->inCode()) { lil_->setRootCode() = code; }
+    lil_->pushCode(body->code_.c_str(), body->codeLen_);
+    lil_->incrParse_depth(1); // Start new parse level.
+    frames_.push_back(Lil_vmFrame{CAST(INT)bc_.ops_.size(), 0, 0});
+    if (lil_->sysInfo_->limit_ParseDepth_ && lil_->getParse_depth() > lil_->sysInfo_->limit_ParseDepth_) {
+        LIL_PARSE_ERROR(lil_->sysInfo_);
+        lil_set_error(lil_, L_VSTR(0xee78, "Too many recursive calls")); // #INTERP_ERR
+        pc_ = CAST(INT)bc_.ops_.size();
+    } else {
+        if (lil_->getParse_depth() == 1) { lil_->SETERROR(ErrorCode()); }
+        lil_->getEnv()->setBreakrun() = false;
+    }
+}
+
+Lil_vm::~Lil_vm() { lil_->popCode(codeDepth_); } // #dtor
+
+Lil_value_Ptr Lil_vm::finish() {
+    auto lil = lil_;
+    auto val = val_;
+    val_ = nullptr;
     if (lil->getError().inError() && lil->getCallback(LIL_CALLBACK_ERROR) && lil->getParse_depth() == 1) {
-        // Got to top with "break-like" command and run callback to handle that.
         auto proc = (lil_error_callback_proc_t) lil->getCallback(LIL_CALLBACK_ERROR);
         proc(lil, lil->getErr_head(), lil->getErrMsg().c_str());
     }
-    if (words) { lil_free_list(words); }
-    lil->setCode(save_code.c_str(), save_clen, save_head); // Restore code to original.
-    if (funclevel && lil->getEnv()->getRetval_set()) { // Handle return value.
+    lil->popCode(codeDepth_); // Restore code to original.
+    if (lil->getEnv()->getRetval_set()) { // Handle return value.
         if (val) { lil_free_value(val); }
         val = lil->getEnv()->getReturnVal();
         lil->getEnv()->setReturnVal() = nullptr;
@@ -743,7 +1828,290 @@ Lil_value_Ptr lil_parse(LilInterp_Ptr lil, lcstrp code, INT codelen, INT funclev
         lil->getEnv()->setBreakrun()   = false;
     }
     lil->incrParse_depth(-1); // Done with this parse level.
-    return val ? val : new Lil_value(lil); // Return value or nullptr.
+    return val ? val : new Lil_value(lil);
+}
+
+// Words of the command can't all be had, drop the command and end the block.
+void Lil_vm::abortCmd() {
+    while (stack_.size() > frames_.back().base_) {
+        lil_free_value(stack_.back());
+        stack_.pop_back();
+    }
+    pc_ = frames_.back().end_;
+}
+
+bool Lil_vm::isBuiltin(INT builtin) {
+    auto& b = bc_.builtins_[CAST(size_t)builtin];
+    return lil_->find_cmd(b.first, bc_.builtinSites_[CAST(size_t)builtin]) == b.second;
+}
+
+// Variable in the slot of literal lit if this callframe has the slots of bc_, else nullptr.
+Lil_var_Ptr Lil_vm::slotVar(INT lit) {
+    INT slot = bc_.litSlots_[CAST(size_t)lit];
+    auto env = lil_->getEnv();
+    return (slot >= 0 && env->getSlotNames() == bc_.slotNames_) ? env->getSlotVar(slot) : nullptr;
+}
+
+void Lil_vm::fixErrorHead() {
+    if (lil_->getError().val() == ERROR_FIXHEAD) {
+        lil_->setError(LIL_ERROR(ERROR_DEFAULT), lil_->getHead());
+    }
+}
+
+void Lil_vm::cmd() {
+    if (lil_->getError().inError()) { pc_ = frames_.back().end_; return; }
+    if (val_) { lil_free_value(val_); }
+    val_ = nullptr;
+}
+
+void Lil_vm::endCmd() {
+    if (lil_->getEnv()->getBreakrun()) { pc_ = frames_.back().end_; } // A "break-like" command was executed.
+}
+
+void Lil_vm::head(const Lil_op& op) {
+    lil_->moveHead(op.a_);
+}
+
+void Lil_vm::pushLit(const Lil_op& op) {
+    stack_.push_back(new Lil_value(lil_, bc_.lits_[CAST(size_t)op.a_]));
+}
+
+void Lil_vm::pushPart(const Lil_op& op) {
+    stack_.push_back(_eval_part(lil_, *bc_.parts_[CAST(size_t)op.a_]));
+    if (lil_->getError().inError()) { abortCmd(); }
+}
+
+void Lil_vm::loadVar(const Lil_op& op) {
+    // Same as running "set name" unless that could end differently.
+    if (_can_read_var(lil_, bc_.builtins_[CAST(size_t)op.c_].second)) {
+        Lil_var_Ptr var = slotVar(op.a_); // Local, so no GETVAR callback.
+        if (var) {
+            lil_->sysInfo_->numDirectVarReads_++;
+            stack_.push_back(var->getValue() ? lil_clone_value(var->getValue()) : new Lil_value(lil_));
+        } else {
+            stack_.push_back(_read_var(lil_, bc_.lits_[CAST(size_t)op.a_].c_str()));
+        }
+    } else {
+        stack_.push_back(_eval_part(lil_, *bc_.parts_[CAST(size_t)op.b_]));
+        if (lil_->getError().inError()) { abortCmd(); }
+    }
+}
+
+void Lil_vm::append(const Lil_op& op) {
+    size_t first = stack_.size() - CAST(size_t)op.a_;
+    auto   w     = new Lil_value(lil_);
+    for (size_t i = first; i < stack_.size(); i++) {
+        lil_append_val(w, stack_[i]);
+        lil_free_value(stack_[i]);
+    }
+    stack_.resize(first);
+    stack_.push_back(w);
+}
+
+void Lil_vm::call(const Lil_op& op) {
+    size_t first = stack_.size() - CAST(size_t)op.a_;
+    {
+        Lil_list_SPtr words(arena_.alloc_list(lil_, op.a_)); // Delete on exit.
+        for (size_t i = first; i < stack_.size(); i++) { lil_list_append(words.v, stack_[i]); }
+        stack_.resize(first);
+        lil_->moveHead(op.b_);
+        val_ = _run_cmd(lil_, words.v, op.c_ < 0 ? nullptr : bc_.sites_[CAST(size_t)op.c_]);
+    }
+    arena_.release();
+}
+
+void Lil_vm::storeVar(const Lil_op& op) {
+    Lil_value_SPtr value(stack_.back()); // Delete on exit.
+    stack_.pop_back();
+    lil_->moveHead(op.b_);
+    if (isBuiltin(op.c_)) {
+        lil_->sysInfo_->numCommandsRun_++;
+        Lil_var_Ptr var = slotVar(op.a_); // Local, so no SETVAR callback.
+        if (var && !var->hasWatchCode()) {
+            var->setValue(lil_clone_value(value.v));
+        } else {
+            var = lil_set_var(lil_, bc_.lits_[CAST(size_t)op.a_].c_str(), value.v, LIL_SETVAR_LOCAL);
+        }
+        val_ = var ? lil_clone_value(var->getValue()) : nullptr;
+        fixErrorHead();
+    } else {
+        Lil_list_SPtr words(lil_alloc_list(lil_)); // Delete on exit.
+        lil_list_append(words.v, new Lil_value(lil_, bc_.builtins_[CAST(size_t)op.c_].first));
+        lil_list_append(words.v, new Lil_value(lil_, bc_.lits_[CAST(size_t)op.a_]));
+        lil_list_append(words.v, value.v);
+        value.v = nullptr;
+        val_ = _run_cmd(lil_, words.v);
+    }
+}
+
+void Lil_vm::guard(const Lil_op& op) {
+    if (!isBuiltin(op.a_)) { pc_ = op.b_; }
+}
+
+void Lil_vm::enter(const Lil_op& op) {
+    auto& parsed = bc_.codes_[CAST(size_t)op.a_];
+    lil_->sysInfo_->numEvalCalls_++;
+    frames_.push_back(Lil_vmFrame{op.b_, stack_.size(), op.a_});
+    lil_->pushCode(parsed->code_.c_str(), parsed->codeLen_);
+    lil_->incrParse_depth(1); // Start new parse level.
+    if (lil_->sysInfo_->limit_ParseDepth_ && lil_->getParse_depth() > lil_->sysInfo_->limit_ParseDepth_) {
+        LIL_PARSE_ERROR(lil_->sysInfo_);
+        lil_set_error(lil_, L_VSTR(0xee78, "Too many recursive calls")); // #INTERP_ERR
+        pc_ = op.b_;
+    }
+}
+
+void Lil_vm::leave(const Lil_op& op) {
+    lil_->popCode(lil_->getCodeDepth() - 1); // Restore code to original.
+    lil_->incrParse_depth(-1); // Done with this parse level.
+    frames_.pop_back();
+    if (op.op_ == LIL_OP_LEAVE_WORD) {
+        stack_.push_back(val_ ? val_ : new Lil_value(lil_));
+        val_ = nullptr;
+        if (lil_->getError().inError()) { abortCmd(); }
+    }
+}
+
+void Lil_vm::drop() {
+    if (val_) { lil_free_value(val_); }
+    val_ = nullptr;
+}
+
+void Lil_vm::jump(const Lil_op& op) {
+    pc_ = op.a_;
+}
+
+void Lil_vm::jumpIf(const Lil_op& op) {
+    Lil_value_Ptr cond = lil_eval_expr(lil_, bc_.exprs_[CAST(size_t)op.a_]);
+    if (!cond || lil_->getError().inError()) {
+        if (cond) { lil_free_value(cond); }
+        pc_ = op.c_;
+        return;
+    }
+    bool v = lil_to_boolean(cond);
+    lil_free_value(cond);
+    if (v == (op.op_ == LIL_OP_JUMP_TRUE)) { pc_ = op.b_; }
+}
+
+void Lil_vm::loop() {
+    loops_.emplace_back();
+}
+
+void Lil_vm::loopCheck(const Lil_op& op) {
+    if (lil_->getError().inError() || lil_->getEnv()->getBreakrun()) { pc_ = op.a_; }
+}
+
+void Lil_vm::loopBody() { // Last result may share a list the body changes in place (append).
+    if (loops_.back().r_) { lil_free_value(loops_.back().r_); }
+    loops_.back().r_ = nullptr;
+}
+
+void Lil_vm::loopKeep() {
+    if (loops_.back().r_) { lil_free_value(loops_.back().r_); }
+    loops_.back().r_ = val_;
+    val_ = nullptr;
+}
+
+void Lil_vm::loopEnd(const Lil_op& op) {
+    if (op.a_) { // Expression failed, no result.
+        if (loops_.back().r_) { lil_free_value(loops_.back().r_); }
+    } else {
+        val_ = loops_.back().r_;
+    }
+    loops_.pop_back();
+}
+
+void Lil_vm::countTest(const Lil_op& op) {
+    auto& loop = bc_.counted_[CAST(size_t)op.a_];
+    INT   v    = _counted_test(lil_, loop, bc_.builtins_[CAST(size_t)loop.setBuiltin_].second);
+    if (v >= 0) { pc_ = v ? op.c_ : op.b_; }
+}
+
+void Lil_vm::countStep(const Lil_op& op) {
+    auto& loop = bc_.counted_[CAST(size_t)op.a_];
+    if (isBuiltin(loop.stepBuiltin_) && _counted_step(lil_, loop)) { pc_ = op.b_; }
+}
+
+void Lil_vm::foreach(const Lil_op& op) {
+    if (!isBuiltin(op.c_)) { pc_ = op.b_; return; }
+    size_t first = stack_.size() - CAST(size_t)op.a_;
+    auto&  loop  = loops_.emplace_back();
+    loop.var_   = op.a_ == 4 ? lil_to_string(stack_[first + 1]) : L_STR("i");
+    loop.list_  = Lil_listRef(lil_, stack_[first + CAST(size_t)op.a_ - 2]).v;
+    loop.rlist_ = lil_alloc_list(lil_);
+    for (size_t i = first; i < stack_.size(); i++) { lil_free_value(stack_[i]); }
+    stack_.resize(first);
+}
+
+void Lil_vm::foreachNext(const Lil_op& op) {
+    auto& loop = loops_.back();
+    if (loop.idx_ >= loop.list_->getCount()) { pc_ = op.a_; return; }
+    lil_set_var(lil_, loop.var_.c_str(), loop.list_->getValue(loop.idx_++), LIL_SETVAR_LOCAL_ONLY);
+}
+
+void Lil_vm::foreachKeep(const Lil_op& op) {
+    if (val_ && val_->getValueLen()) { lil_list_append(loops_.back().rlist_, val_); }
+    else if (val_) { lil_free_value(val_); }
+    val_ = nullptr;
+    pc_ = (lil_->getEnv()->getBreakrun() || lil_->getError().inError()) ? op.a_ : op.b_;
+}
+
+void Lil_vm::foreachEnd() {
+    val_ = _list_to_cached_value(lil_, loops_.back().rlist_);
+    loops_.pop_back();
+}
+
+void Lil_vm::builtinEnd() {
+    lil_->sysInfo_->numCommandsRun_++;
+    fixErrorHead();
+}
+
+void Lil_vm::step(const Lil_op& op) {
+    switch (op.op_) {
+        case LIL_OP_CMD:          cmd(); break;
+        case LIL_OP_END_CMD:      endCmd(); break;
+        case LIL_OP_HEAD:         head(op); break;
+        case LIL_OP_PUSH_LIT:     pushLit(op); break;
+        case LIL_OP_PUSH_PART:    pushPart(op); break;
+        case LIL_OP_LOAD_VAR:     loadVar(op); break;
+        case LIL_OP_APPEND:       append(op); break;
+        case LIL_OP_CALL:         call(op); break;
+        case LIL_OP_STORE_VAR:    storeVar(op); break;
+        case LIL_OP_GUARD:        guard(op); break;
+        case LIL_OP_ENTER:        enter(op); break;
+        case LIL_OP_LEAVE:
+        case LIL_OP_LEAVE_WORD:   leave(op); break;
+        case LIL_OP_DROP:         drop(); break;
+        case LIL_OP_JUMP:         jump(op); break;
+        case LIL_OP_JUMP_FALSE:
+        case LIL_OP_JUMP_TRUE:    jumpIf(op); break;
+        case LIL_OP_LOOP:         loop(); break;
+        case LIL_OP_LOOP_CHECK:   loopCheck(op); break;
+        case LIL_OP_LOOP_BODY:    loopBody(); break;
+        case LIL_OP_LOOP_KEEP:    loopKeep(); break;
+        case LIL_OP_LOOP_END:     loopEnd(op); break;
+        case LIL_OP_COUNT_TEST:   countTest(op); break;
+        case LIL_OP_COUNT_STEP:   countStep(op); break;
+        case LIL_OP_FOREACH:      foreach(op); break;
+        case LIL_OP_FOREACH_NEXT: foreachNext(op); break;
+        case LIL_OP_FOREACH_KEEP: foreachKeep(op); break;
+        case LIL_OP_FOREACH_END:  foreachEnd(); break;
+        case LIL_OP_BUILTIN_END:  builtinEnd(); break;
+        default:
+            assert(false);
+            break;
+    }
+}
+
+// Run body of a "proc" command, as bytecode unless it didn't compile.
+ND static Lil_value_Ptr _run_func_body(LilInterp_Ptr lil, Lil_func_Ptr cmd) { // #private
+    assert(lil!=nullptr); assert(cmd!=nullptr);
+    if (lil->sysInfo_->funcBytecode_ && !lil->getIgnoreEol()) { // Compiled for EOL ending commands.
+        auto bc = _find_func_bytecode(lil, cmd); // Keep alive while running.
+        if (!bc->fallback_) { return _run_bytecode(lil, bc, cmd->getCode()->getValue().c_str()); }
+    }
+    auto body = _find_func_parsed_code(lil, cmd); // Keep alive while running.
+    return _run_parsed_code(lil, body, cmd->getCode()->getValue().c_str(), 1);
 }
 
 Lil_value_Ptr lil_parse_value(LilInterp_Ptr lil, Lil_value_Ptr val, INT funclevel) {
@@ -772,9 +2140,72 @@ INT lil_error(LilInterp_Ptr lil, lcstrp *msg, INT *pos) {
     return lil->getErrorInfo(msg, pos);
 }
 
+// Add "$name" as a cell of the expression text.  Called from _compile_expr()
+ND static bool _expr_var_cell(Lil_exprProgram& prog, const Lil_parsedPart& part, std::vector<Lil_exprCell>& cells) { // #private
+    auto& name = part.parts_[0];
+    if (name.type_ != LIL_PART_LITERAL || !_is_plain_name(name.text())) { return false; }
+    auto it = std::find(prog.vars_.begin(), prog.vars_.end(), name.text());
+    if (it == prog.vars_.end()) { it = prog.vars_.emplace(it, name.text()); }
+    cells.push_back(Lil_exprCell{LC('\0'), CAST(INT)(it - prog.vars_.begin())});
+    return true;
+}
+
+// Compile expression text the way lil_subst_to_value() would substitute it.  Called from lil_eval_expr()
+ND static Lil_exprProgram_Ptr _compile_expr(LilInterp_Ptr lil, Lil_value_Ptr code) { // #private
+    assert(lil!=nullptr); assert(code!=nullptr);
+    auto prog     = std::make_shared<Lil_exprProgram>();
+    bool save_eol = lil->getIgnoreEol();
+    lil->setIgnoreEol() = true;
+    auto parsed = _parse_code(lil, lil_to_string(code), code->getValueLen());
+    lil->setIgnoreEol() = save_eol;
+    if (parsed->cmds_.size() > 1 || (!parsed->cmds_.empty() && parsed->cmds_[0].parseError_)) { return prog; }
+
+    std::vector<Lil_exprCell> cells;
+    auto addText = [&](lstring_view text) { for (auto ch : text) { cells.push_back(Lil_exprCell{ch, -1}); } };
+    if (!parsed->cmds_.empty()) {
+        for (auto& part : parsed->cmds_[0].parts_) {
+            if (part.wordStart_ && !cells.empty()) { addText(L_STR(" ")); } // Words are joined with ' '.
+            switch (part.type_) {
+                case LIL_PART_LITERAL:
+                    addText(part.text());
+                    break;
+                case LIL_PART_DOLLAR:
+                    if (!_expr_var_cell(*prog, part, cells)) { return prog; }
+                    break;
+                case LIL_PART_QUOTE:
+                    for (auto& qp : part.parts_) {
+                        if (qp.type_ == LIL_PART_LITERAL) { addText(qp.text()); }
+                        else if (qp.type_ != LIL_PART_DOLLAR || !_expr_var_cell(*prog, qp, cells)) { return prog; }
+                    }
+                    break;
+                case LIL_PART_BRACKET: // Commands are left to the text way.
+                default:
+                    return prog;
+            }
+        }
+    }
+    _ee_compile(lil, *prog, cells);
+    return prog;
+}
+
 Lil_value_Ptr lil_eval_expr(LilInterp_Ptr lil, Lil_value_Ptr code) { // #topic numExprErrors
     assert(lil!=nullptr); assert(code!=nullptr);
     lil->sysInfo_->numExpressions_++;
+    // Only text with variables in it is likely to come back, anything else is usually already substituted values.
+    if (lil->sysInfo_->exprCacheMaxSize_ && code->getValueLen() <= lil->sysInfo_->parseCacheMaxCodeLen_ &&
+        code->getValue().find(LC('$')) != lstring::npos) {
+        auto prog = lil->findExprProgram(code->getValue());
+        if (!prog) {
+            prog = _compile_expr(lil, code);
+            lil->addExprProgram(code->getValue(), prog);
+        }
+        Lil_exprNum num;
+        if (_ee_run(lil, *prog, num)) {
+            if (num.type_ == EE_INT) { return lil_alloc_integer(lil, num.integerVal_); }
+            return lil_alloc_double(lil, num.doubleVal_);
+        }
+        lil->sysInfo_->numExprFallbacks_++;
+    }
     code = lil_subst_to_value(lil, code);
     if (lil->getError().inError()) return nullptr; // #ERR_RET
     Lil_exprVal ee(lil, code);
@@ -828,10 +2259,35 @@ lcstrp lil_to_string(Lil_value_Ptr val) {
     return (val && val->getValueLen()) ? val->getValue().c_str() : L_STR("");
 }
 
+// Generate string of a value made by setInteger() or setList().
+void Lil_value::genString() const {
+    if (isInt_) {
+        lchar buff[128]; // #magic
+        LSPRINTF(buff, "%li", intRep_);
+        value_ = buff;
+    } else if (listRep_) {
+        _list_to_text(listRep_.get(), true, value_);
+    } else {
+        assert(dictRep_!=nullptr);
+        _dict_to_text(*dictRep_, value_);
+    }
+    strValid_ = true;
+    sysInfo_->numValueStrGens_++;
+}
+
 // Get double value from Lil_value.
 double lil_to_double(Lil_value_Ptr val, bool& inError) {
     assert(val!=nullptr);
     double ret = 0;
+    lilint_t num = 0;
+    if (val->getDoubleRep(ret, inError)) { val->sysInfo_->numValueRepHits_++; return ret; }
+    if (val->getExactInteger(num)) { // #optimization Same as stod() of the "%li" text.
+        val->sysInfo_->numValueRepHits_++;
+        inError = false;
+        ret = CAST(double)num;
+        val->cacheDoubleRep(ret, inError);
+        return ret;
+    }
     try {
         val->sysInfo_->strToDouble_++;
         ret = std::stod(lil_to_string(val));
@@ -846,6 +2302,7 @@ double lil_to_double(Lil_value_Ptr val, bool& inError) {
         inError = true;
     }
     if (inError) val->sysInfo_->failedStrToDouble_++;
+    val->cacheDoubleRep(ret, inError);
     return ret;
 }
 
@@ -854,6 +2311,8 @@ lilint_t lil_to_integer(Lil_value_Ptr val, bool& inError) {
     assert(val!=nullptr);
     // atoll() discards start whitespaces. Return 0 on error.
     // strtoll() discards start whitespaces. Takes start 0 for octal. Takes start 0x/OX for hex
+    lilint_t num = 0;
+    if (val->getIntRep(num, inError)) { val->sysInfo_->numValueRepHits_++; return num; }
     val->sysInfo_->strToInteger_++;
     auto ret = strtoll(lil_to_string(val), nullptr, 0);
     inError = false;
@@ -862,12 +2321,15 @@ lilint_t lil_to_integer(Lil_value_Ptr val, bool& inError) {
         inError = true;
     }
     if (inError) val->sysInfo_->failedStrToInteger_++;
+    val->cacheIntRep(CAST(lilint_t)ret, inError);
     return CAST(lilint_t)ret;
 }
 
 // Get boolean value from Lil_value.
 bool lil_to_boolean(Lil_value_Ptr val) {
     assert(val!=nullptr);
+    lilint_t num = 0;
+    if (val->getExactInteger(num)) { val->sysInfo_->numValueRepHits_++; return num != 0; }
     lcstrp s      = lil_to_string(val);
     INT    dots = 0;
     if (!s[0]) { return false; }
@@ -890,6 +2352,7 @@ Lil_value_Ptr lil_alloc_string(LilInterp_Ptr lil, lcstrp str) {
 }
 
 // Convert double to Lil_value.
+// String is made at once, "%f" loses digits so it is the value of record.
 Lil_value_Ptr lil_alloc_double(LilInterp_Ptr lil, double num) {
     assert(lil!=nullptr);
     lchar buff[128]; // #magic
@@ -900,9 +2363,9 @@ Lil_value_Ptr lil_alloc_double(LilInterp_Ptr lil, double num) {
 // Convert integer into Lil_value.
 Lil_value_Ptr lil_alloc_integer(LilInterp_Ptr lil, lilint_t num) {
     assert(lil!=nullptr);
-    lchar buff[128]; // #magic
-    LSPRINTF(buff, "%li", num);
-    return new Lil_value(lil, buff);
+    auto* val = new Lil_value(lil);
+    val->setInteger(num); // String made lazily.
+    return val;
 }
 
 // Free Lil interpreter.
@@ -922,11 +2385,81 @@ SysInfo* Lil_getSysInfo(bool reset) {
     thread_local SysInfo sysInfo; // NOTE: thread_local works like a static declaration.
     if (reset) {
         sysInfo.printStats();
+        SysSettings settings = sysInfo;
         sysInfo = SysInfo();
+        CAST(SysSettings&)sysInfo = settings;
     }
     return &sysInfo;
 }
 
+INT Lil_newCmdEpoch() {
+    static std::atomic<INT> lastEpoch{0}; // NOTE: Never reset.
+    return ++lastEpoch;
+}
+
+Lil_symbolTable::Lil_symbolTable() { // #ctor
+    static const Sym_HashTable builtins = [] {
+        Sym_HashTable syms;
+        for (auto& sym : Lil_builtinSymbols()) { syms.emplace(lstring_view(sym.name_), &sym); }
+        return syms;
+    }();
+    syms_ = builtins;
+}
+
+Lil_symbolTable& Lil_getSymbols(LilInterp_Ptr lil) {
+    return lil->getSymbols();
+}
+
+#ifndef LIL_NO_POOLS
+// Pool of memory for T objects, like SysInfo there is one per thread.  An object deleted by another thread than the
+// one that made it goes back to the pool it came from, a pool is freed once its thread has ended and all its objects
+// are deleted. #optimization
+template<typename T>
+struct Lil_pool { // #class
+    static thread_local EjUtil::MemCache<T>* cache_; // Pool of this thread, nullptr once the thread is ending.
+    Lil_pool() { cache_ = new EjUtil::MemCache<T>(); } // #ctor
+    ~Lil_pool() { // #dtor
+        auto cache = cache_;
+        cache_     = nullptr;
+        if (cache->orphan()) { delete cache; }
+    }
+};
+template<typename T>
+thread_local EjUtil::MemCache<T>* Lil_pool<T>::cache_ = nullptr;
+
+template<typename T>
+static EjUtil::MemCache<T>& Lil_getPool() {
+    thread_local Lil_pool<T> pool;
+    return *pool.cache_;
+}
+template<typename T>
+static void* _pool_new(size_t size) {
+    if (size != sizeof(T)) { return ::operator new(size); } // A derived class.
+    auto& pool = Lil_getPool<T>();
+    if (pool.hasFree()) { Lil_getSysInfo()->numPoolHits_++; } else { Lil_getSysInfo()->numPoolMisses_++; }
+    return pool.get();
+}
+template<typename T>
+static void _pool_delete(void* ptr, size_t size) noexcept {
+    if (ptr == nullptr) { return; }
+    if (size != sizeof(T)) { ::operator delete(ptr); return; }
+    auto cache = EjUtil::MemCache<T>::ownerOf(CAST(T*)ptr);
+    if (cache == Lil_pool<T>::cache_) {
+        cache->put(CAST(T*)ptr);
+    } else if (cache->putRemote(CAST(T*)ptr)) { // Made by another thread.
+        delete cache;
+    }
+}
+#define LIL_POOLED_DEF(T) \
+    void* T::operator new(size_t size) { return _pool_new<T>(size); } \
+    void  T::operator delete(void* ptr, size_t size) noexcept { _pool_delete<T>(ptr, size); }
+LIL_POOLED_DEF(Lil_value)
+LIL_POOLED_DEF(Lil_list)
+LIL_POOLED_DEF(Lil_var)
+LIL_POOLED_DEF(Lil_callframe)
+#undef LIL_POOLED_DEF
+#endif
+
 #undef ND
 
 NS_END(LILNS)
@@ -31,6 +31,7 @@
 #include "funcPointers.h"
 #include <cassert>
 #include <climits>
+#include <array>
 
 
 // Allow for mocking functions
@@ -124,7 +125,7 @@ struct Lilstd : public CommandAdaptor {
 [[maybe_unused]] struct fnc_reflect_type : Lilstd { // #cmd
     fnc_reflect_type()  {
         help_ = fnc_reflect_doc; tags_ = "reflect";
-        lilstd.add("reflect", *this, this);
+        lilstd.add("reflect", this);
     }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
@@ -145,7 +146,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
     if (typeObj == L_STR("body")) { // #subcmd
         ARGERR(argc < 2L); // #argErr
         func = _find_cmd(lil, lil_to_string(argv[1]));
-        ARGERR(!func || func->getProc()); // #argErr
+        ARGERR(!func || func->isProc()); // #argErr
         CMD_SUCCESS_RET(lil_clone_value(func->getCode()));
     }
     if (typeObj == L_STR("func-count")) { // #subcmd
@@ -239,7 +240,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_func_type : Lilstd { // #cmd
     fnc_func_type() {
         help_ = fnc_func_doc; tags_ = "language subroutine";
-        lilstd.add("func", *this,  this); }
+        lilstd.add("func", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, ("fnc_func"));
@@ -288,7 +289,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_rename_type : Lilstd { // #cmd
     fnc_rename_type() {
         help_ = fnc_rename_doc; tags_ = "variable";
-        lilstd.add("rename", *this,  this); }
+        lilstd.add("rename", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, ("fnc_rename"));
@@ -306,8 +307,9 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
     r = new Lil_value(lil, func->getName());
     if (newnameObj.length()) {
         lil->hashmap_removeCmd(oldnameObj.c_str());
+        func = lil->ownCmd(func);
+        func->name_ = lil->getSymbols().intern(newnameObj);
         lil->hashmap_addCmd(newnameObj.c_str(), func);
-        func->name_ = newnameObj;
     } else {
         _del_func(lil, func);
     }
@@ -329,7 +331,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct func_unusedname_type : Lilstd { // #cmd
     func_unusedname_type() {
         help_ = fnc_unusedname_doc; tags_ = "subroutine utility";
-        lilstd.add("unusedname", *this,  this); }
+        lilstd.add("unusedname", this); }
     Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
         assert(lil != nullptr);
         assert(argv != nullptr);
@@ -346,7 +348,7 @@ struct func_unusedname_type : Lilstd { // #cmd
 struct fnc_quote_type : Lilstd { // #cmd
     fnc_quote_type() {
         help_ = fnc_quote_doc; tags_ = "string";
-        lilstd.add("quote", *this,  this); }
+        lilstd.add("quote", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_quote");
@@ -375,7 +377,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_set_type : Lilstd { // #cmd
     fnc_set_type() {
         help_ = fnc_set_doc; tags_ = "language variable";
-        lilstd.add("set", *this,  this); }
+        lilstd.add("set", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_set");
@@ -413,7 +415,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_local_type : Lilstd { // #cmd
     fnc_local_type() {
         help_ = fnc_local_doc; tags_ = "variable language";
-        lilstd.add("local", *this,  this); }
+        lilstd.add("local", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_local");
@@ -441,7 +443,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_write_type : Lilstd { // #cmd
     fnc_write_type() {
         help_ = fnc_write_doc; isSafe_ = false; tags_ = "io console";
-        lilstd.add("write", *this,  this); }
+        lilstd.add("write", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_write");
@@ -467,7 +469,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_print_type : Lilstd { // #cmd
     fnc_print_type() {
         help_ = fnc_print_doc; tags_ = "io console";
-        lilstd.add("print", *this,  this); }
+        lilstd.add("print", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_print");
@@ -490,7 +492,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_eval_type : Lilstd { // #cmd
     fnc_eval_type() {
         help_ = fnc_eval_doc; tags_ = "language eval";
-        lilstd.add("eval", *this,  this); }
+        lilstd.add("eval", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_eval");
@@ -524,7 +526,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_topeval_type : Lilstd { // #cmd
     fnc_topeval_type() {
         help_ = fnc_topeval_doc; tags_ = "language variable";
-        lilstd.add("topeval", *this,  this); }
+        lilstd.add("topeval", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_topeval");
@@ -559,7 +561,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_upeval_type : Lilstd { // #cmd
     fnc_upeval_type() {
         help_ = fnc_upeval_doc; tags_ = "language variable";
-        lilstd.add("upeval", *this,  this); }
+        lilstd.add("upeval", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_upeval");
@@ -589,7 +591,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_downeval_type : Lilstd { // #cmd
     fnc_downeval_type() {
         help_ = fnc_downeval_doc; tags_ = "language variable";
-        lilstd.add("downeval", *this,  this); }
+        lilstd.add("downeval", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_downeval");
@@ -630,7 +632,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_enveval_type : Lilstd { // #cmd
     fnc_enveval_type() {
         help_ = fnc_enveval_doc; tags_ = "language variable";
-        lilstd.add("enveval", *this,  this); }
+        lilstd.add("enveval", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_enveval");
@@ -728,7 +730,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_jaileval_type : Lilstd { // #cmd
     fnc_jaileval_type() {
         help_ = fnc_jaileval_doc; tags_ = "language variable";
-        lilstd.add("jaileval", *this,  this); }
+        lilstd.add("jaileval", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_jaileval");
@@ -762,13 +764,13 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_count_type : Lilstd { // #cmd
     fnc_count_type() {
         help_ = fnc_count_doc; tags_ = "list";
-        lilstd.add("jaileval", *this,  this); }
+        lilstd.add("jaileval", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_count");
     lchar buff[64]; // #magic
     if (!argc) { CMD_SUCCESS_RET(new Lil_value(lil, L_STR("0"))); }
-    Lil_list_SPtr list(lil_subst_to_list(lil, argv[0])); // Delete on exit.
+    Lil_listRef list(lil, argv[0]);
     LSPRINTF(buff, L_STR("%lu"), (UINT) list.v->getCount());
     CMD_SUCCESS_RET(new Lil_value(lil, buff));
 }
@@ -787,13 +789,13 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_index_type : Lilstd { // #cmd
     fnc_index_type() {
         help_ = fnc_index_doc; tags_ = "list";
-        lilstd.add("index", *this,  this); }
+        lilstd.add("index", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_index");
     Lil_value_Ptr r;
     ARGERR(argc < 2L); // #argErr
-    Lil_list_SPtr list(lil_subst_to_list(lil, argv[0])); // Delete on exit.
+    Lil_listRef list(lil, argv[0]);
     bool inError = false;
     auto          index = CAST(ARGINT) lil_to_integer(argv[1], inError);
     ARGERR(inError);
@@ -821,13 +823,13 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_indexof_type : Lilstd { // #cmd
     fnc_indexof_type() {
         help_ = fnc_indexof_doc; tags_ = "list";
-        lilstd.add("indexof", *this,  this); }
+        lilstd.add("indexof", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_indexof");
     Lil_value_Ptr r = nullptr;
     ARGERR(argc < 2L); // #argErr
-    Lil_list_SPtr list(lil_subst_to_list(lil, argv[0])); // Delete on exit.
+    Lil_listRef list(lil, argv[0]);
     for (ARGINT   index = 0; index < list.v->getCount(); index++) {
         if (list.v->getValue(INT_val(index))->getValue() == argv[1]->getValue()) {
             r = lil_alloc_integer(lil, lilint_val(index));
@@ -838,6 +840,25 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 }
 } fnc_indexof;
 
+// Change the list in variable name with change(list), returns the new list or nullptr if change() fails.
+// The variable's list is changed in place when it can be, else it is read, changed and set again.
+template<typename F>
+static Lil_value_Ptr _change_var_list(LilInterp_Ptr lil, lcstrp name, LIL_VAR_TYPE access, F change) { // #private
+    assert(lil!=nullptr); assert(name!=nullptr);
+    Lil_value_Ptr value = nullptr;
+    if (auto list = _own_var_list(lil, name, access, value)) {
+        if (!change(list)) { return nullptr; } // #ERR_RET
+        value->listChanged();
+        lil->sysInfo_->numListInPlace_++;
+        return lil_clone_value(value);
+    }
+    Lil_list_SPtr list(lil_subst_to_list(lil, lil_get_var(lil, name)));
+    if (!change(list.v)) { return nullptr; } // #ERR_RET
+    Lil_value_Ptr r = _list_to_cached_value(lil, list.release());
+    lil_set_var(lil, name, r, access);
+    return r;
+}
+
 #if defined(LILCXX_NO_HELP_TEXT)
     [[maybe_unused]] const auto fnc_append_doc = R"cmt()cmt";
 #else
@@ -852,7 +873,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 [[maybe_unused]] struct fnc_append_type : Lilstd { // #cmd
     fnc_append_type() {
         help_ = fnc_append_doc; tags_ = "list";
-        lilstd.add("append", *this,  this); }
+        lilstd.add("append", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_append");
@@ -866,16 +887,231 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
         base    = 2;
         access  = LIL_SETVAR_GLOBAL;
     }
-    Lil_list_SPtr list(lil_subst_to_list(lil, lil_get_var(lil, varnameObj.c_str())));
-    for (ARGINT   i = base; i < argc; i++) {
-        lil_list_append(list.v, lil_clone_value(argv[val(i)]));
-    }
-    Lil_value_Ptr r = lil_list_to_value(lil, list.v, true);
-    lil_set_var(lil, varnameObj.c_str(), r, access);
+    Lil_value_Ptr r = _change_var_list(lil, varnameObj.c_str(), access, [&](Lil_list_Ptr list) {
+        for (ARGINT i = base; i < argc; i++) {
+            lil_list_append(list, lil_clone_value(argv[val(i)]));
+        }
+        return true;
+    });
     CMD_SUCCESS_RET(r);
 }
 } fnc_append;
 
+#if defined(LILCXX_NO_HELP_TEXT)
+    [[maybe_unused]] const auto fnc_lset_doc = R"cmt()cmt";
+#else
+[[maybe_unused]] auto fnc_lset_doc = R"cmt(
+ lset ["global"] <list> <index> <value>
+   sets the <index>-th item of the list in the variable <list> to
+   <value> and returns the list.  The indices begin from zero.  If the
+   "global" special word is used, the list variable is assumed to be a
+   global variable)cmt";
+#endif
+
+[[maybe_unused]] struct fnc_lset_type : Lilstd { // #cmd
+    fnc_lset_type() {
+        help_ = fnc_lset_doc; tags_ = "list";
+        lilstd.add("lset", this); }
+Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
+    assert(lil!=nullptr); assert(argv!=nullptr);
+    LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_lset");
+    ARGINT base   = 0;
+    LIL_VAR_TYPE    access = LIL_SETVAR_LOCAL;
+    ARGERR(argc < 3L); // #argErr
+    if (argv[0]->getValue() == L_STR("global")) { // #option
+        ARGERR(argc < 4L); // #argErr
+        base    = 1;
+        access  = LIL_SETVAR_GLOBAL;
+    }
+    bool inError = false;
+    auto index   = CAST(INT) lil_to_integer(argv[base + 1], inError);
+    ARGERR(inError);
+    Lil_value_Ptr r = _change_var_list(lil, lil_to_string(argv[base]), access, [&](Lil_list_Ptr list) {
+        if (index < 0 || index >= list->getCount()) { return false; }
+        list->setValue(index, lil_clone_value(argv[base + 2]));
+        return true;
+    });
+    ARGERR(!r);
+    CMD_SUCCESS_RET(r);
+}
+} fnc_lset;
+
+#if defined(LILCXX_NO_HELP_TEXT)
+    [[maybe_unused]] const auto fnc_lreplace_doc = R"cmt()cmt";
+#else
+[[maybe_unused]] auto fnc_lreplace_doc = R"cmt(
+ lreplace ["global"] <list> <from> <to> [value ...]
+   replaces the items of the list in the variable <list> from the index
+   <from> to the index <to>-1 with the given values (none removes the
+   items) and returns the list.  The indices are clamped like in slice.
+   If the "global" special word is used, the list variable is assumed
+   to be a global variable)cmt";
+#endif
+
+[[maybe_unused]] struct fnc_lreplace_type : Lilstd { // #cmd
+    fnc_lreplace_type() {
+        help_ = fnc_lreplace_doc; tags_ = "list";
+        lilstd.add("lreplace", this); }
+Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
+    assert(lil!=nullptr); assert(argv!=nullptr);
+    LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_lreplace");
+    ARGINT base   = 0;
+    LIL_VAR_TYPE    access = LIL_SETVAR_LOCAL;
+    ARGERR(argc < 3L); // #argErr
+    if (argv[0]->getValue() == L_STR("global")) { // #option
+        ARGERR(argc < 4L); // #argErr
+        base    = 1;
+        access  = LIL_SETVAR_GLOBAL;
+    }
+    bool inError = false;
+    lilint_t from = lil_to_integer(argv[base + 1], inError);
+    ARGERR(inError);
+    lilint_t to   = lil_to_integer(argv[base + 2], inError);
+    ARGERR(inError);
+    Lil_value_Ptr r = _change_var_list(lil, lil_to_string(argv[base]), access, [&](Lil_list_Ptr list) {
+        auto count = CAST(lilint_t) list->getCount();
+        if (from < 0) { from = 0; }
+        if (from > count) { from = count; }
+        if (to > count) { to = count; }
+        if (to < from) { to = from; }
+        std::vector<Lil_value_Ptr> vals;
+        for (ARGINT i = base + 3; i < argc; i++) { vals.push_back(lil_clone_value(argv[val(i)])); }
+        list->replace(CAST(INT) from, CAST(INT) to, vals);
+        return true;
+    });
+    CMD_SUCCESS_RET(r);
+}
+} fnc_lreplace;
+
+// Change the dictionary in variable name with change(dict), like _change_var_list().
+template<typename F>
+static Lil_value_Ptr _change_var_dict(LilInterp_Ptr lil, lcstrp name, LIL_VAR_TYPE access, F change) { // #private
+    assert(lil!=nullptr); assert(name!=nullptr);
+    Lil_value_Ptr value = nullptr;
+    if (auto dict = _own_var_dict(lil, name, access, value)) {
+        change(dict);
+        value->dictChanged();
+        lil->sysInfo_->numDictInPlace_++;
+        return lil_clone_value(value);
+    }
+    auto dict = _value_dict(lil, lil_get_var(lil, name));
+    if (!dict) { return nullptr; } // #ERR_RET
+    dict = std::make_shared<Lil_dict>(*dict);
+    change(dict.get());
+    Lil_value_Ptr r = _dict_to_value(lil, dict);
+    lil_set_var(lil, name, r, access);
+    return r;
+}
+
+#if defined(LILCXX_NO_HELP_TEXT)
+    [[maybe_unused]] const auto fnc_dict_doc = R"cmt()cmt";
+#else
+[[maybe_unused]] auto fnc_dict_doc = R"cmt(
+ dict create [key value ...]
+   returns a dictionary with the given keys and values.  The string form
+   of a dictionary is a list of its keys and values, so any list with an
+   even number of items can be used as a dictionary
+ dict get <dict> <key>
+   returns the value of <key> in <dict> or an empty string
+ dict exists <dict> <key>
+   returns 1 if <dict> has <key>, else an empty string
+ dict set ["global"] <name> <key> <value>
+   sets <key> to <value> in the dictionary in the variable <name>
+   (creating it if needed) and returns the dictionary
+ dict unset ["global"] <name> <key>
+   removes <key> from the dictionary in the variable <name> and returns
+   the dictionary
+ dict keys <dict>
+   returns a list of the keys of <dict>
+ dict values <dict>
+   returns a list of the values of <dict>
+ dict size <dict>
+   returns the number of keys in <dict>
+ dict for <keyname> <valuename> <dict> <code>
+   for each key of <dict> sets the variables <keyname> and <valuename>
+   to the key and its value and evals <code>.  The results of all
+   evaluations are returned as a list (like foreach))cmt";
+#endif
+
+[[maybe_unused]] struct fnc_dict_type : Lilstd { // #cmd
+    fnc_dict_type() {
+        help_ = fnc_dict_doc; tags_ = "dict";
+        lilstd.add("dict", this); }
+Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
+    assert(lil!=nullptr); assert(argv!=nullptr);
+    LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_dict");
+    ARGERR(!argc); // #argErr
+    auto& typeObj = argv[0]->getValue();
+    if (typeObj == L_STR("create")) { // #subcmd
+        ARGERR(argc % 2 == 0); // #argErr
+        auto dict = std::make_shared<Lil_dict>(lil);
+        for (ARGINT i = 1; i < argc; i += 2) {
+            dict->set(argv[val(i)]->getValue(), lil_clone_value(argv[val(i) + 1]));
+        }
+        CMD_SUCCESS_RET(_dict_to_value(lil, dict));
+    }
+    if (typeObj == L_STR("set") || typeObj == L_STR("unset")) { // #subcmd
+        bool         isSet  = typeObj == L_STR("set");
+        ARGINT       base   = 1;
+        LIL_VAR_TYPE access = LIL_SETVAR_LOCAL;
+        if (argc > 1 && argv[1]->getValue() == L_STR("global")) { // #option
+            base   = 2;
+            access = LIL_SETVAR_GLOBAL;
+        }
+        ARGERR(argc < base + (isSet ? 3 : 2)); // #argErr
+        Lil_value_Ptr r = _change_var_dict(lil, lil_to_string(argv[base]), access, [&](Lil_dict* dict) {
+            if (isSet) { dict->set(argv[base + 1]->getValue(), lil_clone_value(argv[base + 2])); }
+            else { dict->unset(argv[base + 1]->getValue()); }
+        });
+        ARGERR(!r); // #argErr
+        CMD_SUCCESS_RET(r);
+    }
+    if (typeObj == L_STR("for")) { // #subcmd
+        ARGERR(argc < 5L); // #argErr
+        auto dict = _value_dict(lil, argv[3]); // Holding it keeps the code from changing it in place.
+        ARGERR(!dict); // #argErr
+        lcstrp        keyname = lil_to_string(argv[1]);
+        lcstrp        valname = lil_to_string(argv[2]);
+        Lil_list_SPtr rlist(lil_alloc_list(lil)); // Delete on exit.
+        bool          done    = false;
+        dict->forEach([&](const lstring& key, Lil_value_Ptr value) {
+            if (done) { return; }
+            Lil_value_SPtr keyval(new Lil_value(lil, key)); // Delete on exit.
+            lil_set_var(lil, keyname, keyval.v, LIL_SETVAR_LOCAL_ONLY);
+            lil_set_var(lil, valname, value, LIL_SETVAR_LOCAL_ONLY);
+            Lil_value_Ptr rv = lil_parse_value(lil, argv[4], 0);
+            if (rv->getValueLen()) { lil_list_append(rlist.v, rv); }
+            else { lil_free_value(rv); }
+            done = lil->getEnv()->getBreakrun() || lil->getError().inError();
+        });
+        CMD_SUCCESS_RET(_list_to_cached_value(lil, rlist.release()));
+    }
+    ARGERR(argc < 2L); // #argErr
+    auto dict = _value_dict(lil, argv[1]);
+    ARGERR(!dict); // #argErr
+    if (typeObj == L_STR("get")) { // #subcmd
+        ARGERR(argc < 3L); // #argErr
+        CMD_SUCCESS_RET(lil_clone_value(dict->get(argv[2]->getValue())));
+    }
+    if (typeObj == L_STR("exists")) { // #subcmd
+        ARGERR(argc < 3L); // #argErr
+        CMD_SUCCESS_RET(dict->get(argv[2]->getValue()) ? lil_alloc_string(lil, L_STR("1")) : nullptr);
+    }
+    if (typeObj == L_STR("size")) { // #subcmd
+        CMD_SUCCESS_RET(lil_alloc_integer(lil, CAST(lilint_t) dict->getCount()));
+    }
+    if (typeObj == L_STR("keys") || typeObj == L_STR("values")) { // #subcmd
+        bool          keys = typeObj == L_STR("keys");
+        Lil_list_SPtr list(lil_alloc_list(lil)); // Delete on exit.
+        dict->forEach([&](const lstring& key, Lil_value_Ptr value) {
+            lil_list_append(list.v, keys ? new Lil_value(lil, key) : lil_clone_value(value));
+        });
+        CMD_SUCCESS_RET(_list_to_cached_value(lil, list.release()));
+    }
+    ARGERR(true); // #argErr
+}
+} fnc_dict;
+
 #if defined(LILCXX_NO_HELP_TEXT)
     [[maybe_unused]] const auto fnc_slice_doc = R"cmt()cmt";
 #else
@@ -892,7 +1128,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_slice_type : Lilstd { // #cmd
     fnc_slice_type() {
         help_ = fnc_slice_doc; tags_ = "list";
-        lilstd.add("slice", *this,  this); }
+        lilstd.add("slice", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_slice");
@@ -902,7 +1138,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
     lilint_t from = lil_to_integer(argv[1], inError);
     ARGERR(inError);
     if (from < 0) { from = 0; }
-    Lil_list_SPtr list(lil_subst_to_list(lil, argv[0])); // Delete on exit.
+    Lil_listRef list(lil, argv[0]);
     lilint_t      to = argc > 2 ? lil_to_integer(argv[2], inError) : CAST(lilint_t) list.v->getCount();
     ARGERR(inError);
     if (to > CAST(lilint_t) list.v->getCount()) { to = CAST(lilint_t)list.v->getCount(); }
@@ -911,7 +1147,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
     for (auto     i = CAST(ARGINT) from; i < CAST(ARGINT) to; i++) {
         lil_list_append(slice.v, lil_clone_value(list.v->getValue(INT_val(i))));
     }
-    Lil_value_Ptr r = lil_list_to_value(lil, slice.v, true);
+    Lil_value_Ptr r = _list_to_cached_value(lil, slice.release());
     CMD_SUCCESS_RET(r);
 }
 } fnc_slice;
@@ -934,7 +1170,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_filter_type : Lilstd { // #cmd
     fnc_filter_type() {
         help_ = fnc_filter_doc; tags_ = "list";
-        lilstd.add("filter", *this,  this); }
+        lilstd.add("filter", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_filter");
@@ -947,7 +1183,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
         base    = 1;
         varname = lil_to_string(argv[0]);
     }
-    Lil_list_SPtr list(lil_subst_to_list(lil, argv[base])); // Delete on exit.
+    Lil_listRef   list(lil, argv[base]);
     Lil_list_SPtr filtered(lil_alloc_list(lil)); // Delete on exit.
     for (ARGINT   i = 0; i < CAST(INT)list.v->getCount() && !lil->getEnv()->getBreakrun(); i++) {
         lil_set_var(lil, varname, list.v->getValue(INT_val(i)), LIL_SETVAR_LOCAL_ONLY);
@@ -957,7 +1193,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
         }
         lil_free_value(r);
     }
-    r               = lil_list_to_value(lil, filtered.v, true);
+    r               = _list_to_cached_value(lil, filtered.release());
     CMD_SUCCESS_RET(r);
 }
 } fnc_filter;
@@ -974,7 +1210,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_list_type : Lilstd { // #cmd
     fnc_list_type() {
         help_ = fnc_list_doc; tags_ = "list";
-        lilstd.add("list", *this,  this); }
+        lilstd.add("list", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_list");
@@ -982,7 +1218,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
     for (ARGINT   i = 0; i < argc; i++) {
         lil_list_append(list.v, lil_clone_value(argv[val(i)]));
     }
-    Lil_value_Ptr r = lil_list_to_value(lil, list.v, true);
+    Lil_value_Ptr r = _list_to_cached_value(lil, list.release());
     CMD_SUCCESS_RET(r);
 }
 } fnc_list;
@@ -1005,7 +1241,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_subst_type : Lilstd { // #cmd #class
     fnc_subst_type() {
         help_ = fnc_subst_doc; tags_ = "string variable";
-        lilstd.add("subst", *this,  this); }
+        lilstd.add("subst", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_subst");
@@ -1023,7 +1259,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_concat_type : Lilstd { // #cmd #class
     fnc_concat_type() {
         help_ = fnc_concat_doc; tags_ = "string list";
-        lilstd.add("concat", *this,  this); }
+        lilstd.add("concat", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_concat");
@@ -1055,7 +1291,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_foreach_type : Lilstd { // #cmd #class
     fnc_foreach_type() {
         help_ = fnc_foreach_doc; tags_ = "language loop";
-        lilstd.add("foreach", *this,  this); }
+        lilstd.add("foreach", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_foreach");
@@ -1068,7 +1304,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
         codeIdx = 2;
     }
     Lil_list_SPtr rlist(lil_alloc_list(lil)); // Delete on exit.
-    Lil_list_SPtr list(lil_subst_to_list(lil, argv[val(listIdx)])); // Delete on exit.
+    Lil_listRef   list(lil, argv[val(listIdx)]);
     for (ARGINT   i = 0; i < CAST(INT)list.v->getCount(); i++) {
         Lil_value_Ptr rv;
         lil_set_var(lil, varname, list.v->getValue(INT_val(i)), LIL_SETVAR_LOCAL_ONLY);
@@ -1077,7 +1313,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
         else { lil_free_value(rv); }
         if (lil->getEnv()->getBreakrun() || lil->getError().inError()) { break; }
     }
-    Lil_value_Ptr r = lil_list_to_value(lil, rlist.v, true);
+    Lil_value_Ptr r = _list_to_cached_value(lil, rlist.release());
     CMD_SUCCESS_RET(r);
 }
 } fnc_foreach;
@@ -1097,7 +1333,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_return_type : Lilstd { // #cmd #class
     fnc_return_type() {
         help_ = fnc_return_doc; tags_ = "language subroutine";
-        lilstd.add("return", *this,  this); }
+        lilstd.add("return", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_return");
@@ -1109,6 +1345,44 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 }
 } fnc_return;
 
+#if defined(LILCXX_NO_HELP_TEXT)
+    [[maybe_unused]] const auto fnc_tailcall_doc = R"cmt()cmt";
+#else
+[[maybe_unused]] const auto fnc_tailcall_doc = R"cmt(
+ tailcall <name> [args...]
+   stops the execution of a function's code like return and calls
+   <name> with the given arguments in place of the function, the result
+   of the call is the result of the function.  When <name> is a function
+   it runs in the same callframe, so a function that calls itself this
+   way runs in constant stack.  Any other command runs as the end of the
+   function, so "tailcall return 5" returns 5 from the function and
+   "tailcall upeval ..." runs code in its caller.  Can only be used
+   inside a function)cmt";
+#endif
+
+[[maybe_unused]]
+struct fnc_tailcall_type : Lilstd { // #cmd #class
+    fnc_tailcall_type() {
+        help_ = fnc_tailcall_doc; tags_ = "language subroutine";
+        lilstd.add("tailcall", this); }
+Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
+    assert(lil!=nullptr); assert(argv!=nullptr);
+    LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_tailcall");
+    ARGERR(argc < 1L); // #argErr
+    if (!lil->getEnv()->getFunc()) {
+        lil_set_error_at(lil, lil->getHead(), L_VSTR(0x6c1d, "tailcall outside of a function")); // #INTERP_ERR
+        CMD_ERROR_RET(nullptr);
+    }
+    Lil_list_Ptr words = lil_alloc_list(lil);
+    for (ARGINT i = 0; i < argc; i++) {
+        lil_list_append(words, lil_clone_value(argv[i]));
+    }
+    lil->getEnv()->setTailCall(words); // Run by _run_cmd() once the function's code stops.
+    lil->getEnv()->setBreakrun() = true;
+    CMD_SUCCESS_RET(nullptr);
+}
+} fnc_tailcall;
+
 #if defined(LILCXX_NO_HELP_TEXT)
     [[maybe_unused]] const auto fnc_result_doc = R"cmt()cmt";
 #else
@@ -1127,7 +1401,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_result_type : Lilstd { // #cmd #class
     fnc_result_type() {
         help_ = fnc_result_doc; tags_ = "language subroutine";
-        lilstd.add("result", *this,  this); }
+        lilstd.add("result", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_result");
@@ -1186,7 +1460,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_expr_type : Lilstd { // #cmd #class
     fnc_expr_type() {
         help_ = fnc_expr_doc; tags_ = "language math logic expression";
-        lilstd.add("expr", *this,  this); }
+        lilstd.add("expr", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_expr");
@@ -1234,7 +1508,7 @@ static Lil_value_Ptr _real_inc(LilInterp_Ptr lil, lcstrp varname, double v) {  /
 struct fnc_inc_type : Lilstd { // #cmd #class
     fnc_inc_type() {
         help_ = fnc_inc_doc; tags_ = "math";
-        lilstd.add("inc", *this,  this); }
+        lilstd.add("inc", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_inc");
@@ -1259,7 +1533,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_dec_type : Lilstd { // #cmd #class
     fnc_dec_type() {
         help_ = fnc_dec_doc; tags_ = "math";
-        lilstd.add("dec", *this,  this); }
+        lilstd.add("dec", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_dec");
@@ -1287,7 +1561,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_read_type : Lilstd { // #cmd #class
     fnc_read_type() {
         help_ = fnc_read_doc; isSafe_ = false; tags_ = "io file";
-        lilstd.add("read", *this,  this); }
+        lilstd.add("read", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_read");
@@ -1334,7 +1608,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_store_type : Lilstd { // #cmd #class
     fnc_store_type() {
         help_ = fnc_store_doc; isSafe_ = false; tags_ = "io file";
-        lilstd.add("store", *this,  this); }
+        lilstd.add("store", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_store");
@@ -1372,7 +1646,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_if_type : Lilstd { // #cmd #class
     fnc_if_type() {
         help_ = fnc_if_doc; tags_ = "language logic conditional";
-        lilstd.add("if", *this,  this); }
+        lilstd.add("if", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_if");
@@ -1407,11 +1681,42 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
    also return an empty value))cmt";
 #endif
 
+// Run while/for loop as a counted loop (#optimization) as long as its condition and step can be done with native
+// integers, see Lil_countedLoop.  done is false if the loop isn't one or has to go on the generic way from its
+// condition (the step was run).  Returns last result of code.
+static Lil_value_Ptr _run_counted_loop(LilInterp_Ptr lil, Lil_value_Ptr cond, Lil_value_Ptr step, Lil_value_Ptr code,
+                                       bool bnot, bool& done) { // #private
+    assert(lil!=nullptr); assert(cond!=nullptr); assert(code!=nullptr);
+    Lil_countedLoop loop;
+    done = false;
+    if (!_match_counted_cond(cond->getValue(), loop) || (step && !_match_counted_step(step->getValue(), loop))) {
+        return nullptr;
+    }
+    Lil_func_Ptr  setFunc  = lil->find_sys_cmd(L_STR("set"));
+    Lil_func_Ptr  stepFunc = step ? lil->find_sys_cmd(loop.stepCmd_.c_str()) : nullptr;
+    Lil_cmdSite   stepSite;
+    Lil_value_Ptr r        = nullptr;
+    while (!lil->getError().inError() && !lil->getEnv()->getBreakrun()) {
+        INT v = _counted_test(lil, loop, setFunc);
+        if (v < 0) { return r; }
+        if (bnot) { v = !v; }
+        if (!v) { break; }
+        if (r) { lil_free_value(r); }
+        r = lil_parse_value(lil, code, 0);
+        if (step && !(stepFunc && lil->find_cmd(loop.stepCmd_, stepSite) == stepFunc && _counted_step(lil, loop))) {
+            lil_free_value(lil_parse_value(lil, step, 0));
+            return r;
+        }
+    }
+    done = true;
+    return r;
+}
+
 [[maybe_unused]]
 struct fnc_while_type : Lilstd { // #cmd #class
     fnc_while_type() {
         help_ = fnc_while_doc; tags_ = "language loop";
-        lilstd.add("while", *this,  this); }
+        lilstd.add("while", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_while");
@@ -1421,6 +1726,9 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
     auto& argv0 = argv[0]->getValue();
     if (argv0 == L_STR("bnot_")) { base = bnot_ = 1; } // #option
     ARGERR(argc < CAST(ARGINT) (base + 2)); // #argErr
+    bool done;
+    r = _run_counted_loop(lil, argv[base], nullptr, argv[base + 1], bnot_, done);
+    if (done) { CMD_SUCCESS_RET(r); }
     while (!lil->getError().inError() && !lil->getEnv()->getBreakrun()) {
         Lil_value_SPtr val(lil_eval_expr(lil, argv[base])); // Delete on exit.
         if (!val.v || lil->getError().inError()) { CMD_ERROR_RET(nullptr); } // #argErr
@@ -1451,13 +1759,16 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_for_type : Lilstd { // #cmd #class
     fnc_for_type() {
         help_ = fnc_for_doc; tags_ = "language loop";
-        lilstd.add("for", *this,  this); }
+        lilstd.add("for", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_for");
     Lil_value_Ptr r = nullptr;
     ARGERR(argc < 4L); // #argErr
     lil_free_value(lil_parse_value(lil, argv[0], 0));
+    bool done;
+    r = _run_counted_loop(lil, argv[1], argv[2], argv[3], false, done);
+    if (done) { CMD_SUCCESS_RET(r); }
     while (!lil->getError().inError() && !lil->getEnv()->getBreakrun()) {
         Lil_value_SPtr val(lil_eval_expr(lil, argv[1])); // Delete on exit.
         if (!val.v || lil->getError().inError()) { CMD_ERROR_RET(nullptr); } // #argErr
@@ -1487,7 +1798,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_char_type : Lilstd { // #cmd #class
     fnc_char_type() {
         help_ = fnc_char_doc; tags_ = "string character";
-        lilstd.add("char", *this,  this); }
+        lilstd.add("char", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_char");
@@ -1515,7 +1826,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_charat_type : Lilstd { // #cmd #class
     fnc_charat_type() {
         help_ = fnc_charat_doc; tags_ = "string character";
-        lilstd.add("charat", *this,  this); }
+        lilstd.add("charat", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_charat");
@@ -1546,7 +1857,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_codeat_type : Lilstd { // #cmd #class
     fnc_codeat_type() {
         help_ = fnc_codeat_doc; tags_ = "string character";
-        lilstd.add("codeat", *this,  this); }
+        lilstd.add("codeat", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_codeat");
@@ -1587,7 +1898,7 @@ static auto _str_to_integer(const char* val, bool& inError) {
 struct fnc_substr_type : Lilstd { // #cmd #class
     fnc_substr_type() {
         help_ = fnc_substr_doc; tags_ = "string";
-        lilstd.add("substr", *this,  this); }
+        lilstd.add("substr", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_substr");
@@ -1625,7 +1936,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_strpos_type : Lilstd { // #cmd #class
     fnc_strpos_type() {
         help_ = fnc_strpos_doc; tags_ = "string";
-        lilstd.add("strpos", *this,  this); }
+        lilstd.add("strpos", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_strpos");
@@ -1656,7 +1967,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_length_type : Lilstd { // #cmd #class
     fnc_length_type() {
         help_  = fnc_length_doc; tags_ = "list string";
-        lilstd.add("length", *this,  this); }
+        lilstd.add("length", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_length");
@@ -1703,7 +2014,7 @@ static Lil_value_Ptr _real_trim(LilInterp_Ptr lil, lcstrp str, lcstrp chars, INT
 struct fnc_trim_type : Lilstd { // #cmd #class
     fnc_trim_type() {
         help_ = fnc_trim_doc; tags_ = "string";
-        lilstd.add("trim", *this,  this); }
+        lilstd.add("trim", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_trim");
@@ -1725,7 +2036,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_ltrim_type : Lilstd { // #cmd #class
     fnc_ltrim_type() {
         help_ = fnc_ltrim_doc; tags_ = "string";
-        lilstd.add("ltrim", *this,  this); }
+        lilstd.add("ltrim", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_ltrim");
@@ -1747,7 +2058,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_rtrim_type : Lilstd { // #cmd #class
     fnc_rtrim_type() {
         help_ = fnc_rtrim_doc; tags_ = "string";
-        lilstd.add("rtrim", *this,  this); }
+        lilstd.add("rtrim", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_rtrim");
@@ -1771,7 +2082,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_strcmp_type : Lilstd { // #cmd #class
     fnc_strcmp_type() {
         help_ = fnc_strcmp_doc; tags_ = "string";
-        lilstd.add("strcmp", *this,  this); }
+        lilstd.add("strcmp", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_strcmp");
@@ -1793,7 +2104,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_streq_type : Lilstd { // #cmd #class
     fnc_streq_type() {
         help_ = fnc_streq_doc; tags_ = "string";
-        lilstd.add("streq", *this,  this); }
+        lilstd.add("streq", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_streq");
@@ -1828,7 +2139,7 @@ static void FindAndReplace(std::string &data, const std::string& Searching, cons
 struct fnc_repstr_type : Lilstd { // #cmd #class
     fnc_repstr_type() {
         help_ = fnc_repstr_doc; tags_ = "string";
-        lilstd.add("repstr", *this,  this); }
+        lilstd.add("repstr", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_repstr");
@@ -1861,7 +2172,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_split_type : Lilstd { // #cmd #class
     fnc_split_type() {
         help_ = fnc_split_doc; tags_ = "string list";
-        lilstd.add("split", *this,  this); }
+        lilstd.add("split", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_split");
@@ -1883,7 +2194,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
         }
     }
     lil_list_append(list.v, val);
-    val = lil_list_to_value(lil, list.v, true);
+    val = _list_to_cached_value(lil, list.release());
     CMD_SUCCESS_RET(val);
 }
 } fnc_split;
@@ -1904,7 +2215,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_try_type : Lilstd { // #cmd #class
     fnc_try_type() {
         help_ = fnc_try_doc; tags_ = "language exception";
-        lilstd.add("try", *this,  this); }
+        lilstd.add("try", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_try");
@@ -1935,7 +2246,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_error_type : Lilstd { // #cmd #class
     fnc_error_type() {
         help_ = fnc_error_doc; tags_ = "language exception";
-        lilstd.add("error", *this,  this); }
+        lilstd.add("error", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_error");
@@ -1962,7 +2273,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_exit_type : Lilstd { // #cmd #class
     fnc_exit_type() {
         help_ = fnc_exit_doc; tags_ = "language";
-        lilstd.add("exit", *this,  this); }
+        lilstd.add("exit", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_exit");
@@ -1990,7 +2301,7 @@ struct fnc_source_type : Lilstd { // #cmd #class
     fnc_source_type() {
         help_ = fnc_source_doc; isSafe_ = false;
         tags_ = "language io file";
-        lilstd.add("source", *this,  this); }
+        lilstd.add("source", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_source");
@@ -2041,14 +2352,14 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_lmap_type : Lilstd { // #cmd #class
     fnc_lmap_type() {
         help_ = fnc_lmap_doc; tags_ = "list";
-        lilstd.add("lmap", *this,  this); }
+        lilstd.add("lmap", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_lmap");
     ARGERR(argc < 2L); // #argErr
-    Lil_list_SPtr list(lil_subst_to_list(lil, argv[0])); // Delete on exit.
+    Lil_listRef   list(lil, argv[0]);
     for (ARGINT   i = 1; i < argc; i++) {
-        lil_set_var(lil, lil_to_string(argv[val(i)]), lil_list_get(list.v, (Lil::INT)(val(i) - 1)), LIL_SETVAR_LOCAL);
+        lil_set_var(lil, lil_to_string(argv[val(i)]), lil_list_get(list.v.get(), (Lil::INT)(val(i) - 1)), LIL_SETVAR_LOCAL);
     }
     CMD_SUCCESS_RET(nullptr);
 }
@@ -2066,7 +2377,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_rand_type : Lilstd { // #cmd #class
     fnc_rand_type() {
         help_ = fnc_rand_doc; tags_ = "math";
-        lilstd.add("rand", *this,  this); }
+        lilstd.add("rand", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     (void)argc;
@@ -2120,7 +2431,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_catcher_type : Lilstd { // #cmd #class
     fnc_catcher_type() {
         help_ = fnc_catcher_doc; tags_ = "language exception";
-        lilstd.add("catcher", *this,  this); }
+        lilstd.add("catcher", this); }
 Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_catcher");
@@ -2149,7 +2460,7 @@ Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) ov
 struct fnc_watch_type : Lilstd { // #cmd #class
     fnc_watch_type() {
         help_ = fnc_watch_doc; tags_ = "language trace";
-        lilstd.add("watch", *this, this); }
+        lilstd.add("watch", this); }
     Lil_value_Ptr operator()(LilInterp_Ptr lil, ARGINT argc, Lil_value_Ptr *argv) override {
     assert(lil!=nullptr); assert(argv!=nullptr);
     LIL_BEENHERE_CMD(*lil->sysInfo_, "fnc_watch");
@@ -2166,11 +2477,96 @@ struct fnc_watch_type : Lilstd { // #cmd #class
 }
 } fnc_watch;
 
+// Names of the lilstd commands, a builtin's index is where its name is.  Builtins are found with a perfect hash of
+// these made at compile time, a command lilstd.add() gets that isn't here is registered as any other command.
+// #optimization
+static constexpr std::array<lstring_view,59> g_builtinNames = { // #magic
+    "reflect", "func", "rename", "unusedname", "quote", "set", "local", "write", "print", "eval",
+    "topeval", "upeval", "downeval", "enveval", "jaileval", "index", "indexof", "append", "lset", "lreplace",
+    "dict", "slice", "filter", "list", "subst", "concat", "foreach", "return", "result", "expr",
+    "inc", "dec", "read", "store", "if", "while", "for", "char", "charat", "codeat",
+    "substr", "strpos", "length", "trim", "ltrim", "rtrim", "strcmp", "streq", "repstr", "split",
+    "try", "error", "exit", "source", "lmap", "rand", "catcher", "watch", "tailcall",
+};
+static_assert(g_builtinNames.size() <= LIL_MAX_BUILTINS);
+
+// FNV-1a hash of name started from seed.
+static constexpr uint32_t _builtin_hash(lstring_view name, uint32_t seed) { // #private
+    uint32_t h = 2166136261u ^ seed; // #magic
+    for (lchar c : name) { h = (h ^ CAST(uint8_t)c) * 16777619u; } // #magic
+    return h ^ (h >> 15);
+}
+
+// Perfect hash of g_builtinNames, slots_ has the index of each name at the slot _builtin_hash(name, seed_) gives.
+struct Lil_builtinTable { // #class
+    static constexpr size_t  SLOTS = 512; // #magic Plenty of room so a seed is found after a few tries.
+    static constexpr uint8_t EMPTY = 0xFF;
+    uint32_t                  seed_ = 0;
+    std::array<uint8_t,SLOTS> slots_{};
+};
+static_assert(LIL_MAX_BUILTINS < Lil_builtinTable::EMPTY);
+
+// Try seeds until no 2 names are in the same slot.
+static consteval Lil_builtinTable _make_builtin_table() { // #private
+    for (size_t i = 0; i < g_builtinNames.size(); i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (g_builtinNames[i] == g_builtinNames[j]) { throw "duplicate name in g_builtinNames"; }
+        }
+    }
+    Lil_builtinTable table;
+    for (uint32_t seed = 1; ; seed++) {
+        table.seed_ = seed;
+        table.slots_.fill(Lil_builtinTable::EMPTY);
+        bool perfect = true;
+        for (size_t i = 0; perfect && i < g_builtinNames.size(); i++) {
+            auto& slot = table.slots_[_builtin_hash(g_builtinNames[i], seed) % Lil_builtinTable::SLOTS];
+            perfect    = (slot == Lil_builtinTable::EMPTY);
+            slot       = CAST(uint8_t)i;
+        }
+        if (perfect) { return table; }
+    }
+}
+static constexpr Lil_builtinTable g_builtinTable = _make_builtin_table();
+
+INT Lil_builtinIndex(lstring_view name) {
+    uint8_t i = g_builtinTable.slots_[_builtin_hash(name, g_builtinTable.seed_) % Lil_builtinTable::SLOTS];
+    return (i != Lil_builtinTable::EMPTY && g_builtinNames[i] == name) ? i : -1;
+}
+
+const std::vector<Lil_symbol>& Lil_builtinSymbols() {
+    static const std::vector<Lil_symbol> symbols = [] {
+        std::vector<Lil_symbol> syms;
+        for (auto& name : g_builtinNames) {
+            syms.push_back(Lil_symbol{lstring(name), Lil_strHash{}(name), Lil_builtinIndex(name), nullptr});
+        }
+        return syms;
+    }();
+    return symbols;
+}
+
+const std::vector<Lil_func_Ptr>& Lil_getBuiltins(LilInterp_Ptr lil) {
+    static const std::vector<Lil_func_Ptr> builtins = [lil] { // NOTE: Made once even with threads.
+        std::vector<Lil_func_Ptr> funcs(g_builtinNames.size());
+        for (auto& cmd : lilstd.commands_) { // A later one of the same name replaces the earlier.
+            INT i = Lil_builtinIndex(std::get<0>(cmd));
+            if (i < 0) { continue; }
+            auto func = std::make_shared<Lil_func>(lil, std::get<0>(cmd).c_str()); //alloc Lil_func_Ptr
+            func->setFn(std::get<1>(cmd), std::get<2>(cmd));
+            func->sysInfo_ = nullptr; // Outlives the SysInfo of this thread.
+            funcs[CAST(size_t)i] = func;
+        }
+        assert(std::find(funcs.begin(), funcs.end(), nullptr) == funcs.end()); // Every name has a command.
+        return funcs;
+    }();
+    return builtins;
+}
+
 void LilInterp::register_stdcmds() {
+    builtinCmds_ = &Lil_getBuiltins(this);
     for (auto& cmd : lilstd.commands_) {
-        lil_register(this, std::get<0>(cmd).c_str(), std::get<1>(cmd));
+        if (Lil_builtinIndex(std::get<0>(cmd)) >= 0) { continue; }
+        lil_register_fn(this, std::get<0>(cmd).c_str(), std::get<1>(cmd), std::get<2>(cmd));
     }
-    this->defineSystemCmds(); // These are special base commands, so we save that info.
 }
 
 NS_END(LILNS)
@@ -27,6 +27,7 @@
 #include "lil_inter.h"
 #include "narrow_cast.h"
 #include <cassert>
+#include <array>
 
 NS_BEGIN(LILNS)
 
@@ -809,6 +810,406 @@ void _ee_expr(Lil_exprVal *ee) { // #private
     }
 }
 
+// Work out one operator the same as the parsing functions above, false if that's an error.
+ND static bool _ee_apply(LIL_EXPR_OPCODE op, const Lil_exprNum& l, const Lil_exprNum& r, Lil_exprNum& out) { // #private
+    bool lf = l.type_ == EE_FLOAT, rf = r.type_ == EE_FLOAT;
+    auto setInt   = [&](lilint_t v) { out.type_ = EE_INT;   out.integerVal_ = v; };
+    auto setFloat = [&](double v)   { out.type_ = EE_FLOAT; out.doubleVal_  = v; };
+    switch (op) {
+        case LIL_EXPR_NEG:
+            if (lf) { setFloat(-l.doubleVal_); } else { setInt(-l.integerVal_); }
+            break;
+        case LIL_EXPR_BITNOT:
+            setInt(lf ? ~(CAST(lilint_t)l.doubleVal_) : ~l.integerVal_);
+            break;
+        case LIL_EXPR_NOT:
+            if (lf) { setFloat(!l.doubleVal_); } else { setInt(!l.integerVal_); }
+            break;
+        case LIL_EXPR_MUL:
+            if (lf) { setFloat(rf ? r.doubleVal_*l.doubleVal_ : CAST(double)r.integerVal_*l.doubleVal_); }
+            else if (rf) { setFloat(r.doubleVal_*CAST(double)l.integerVal_); }
+            else { setInt(r.integerVal_*l.integerVal_); }
+            break;
+        case LIL_EXPR_MOD:
+        case LIL_EXPR_DIV:
+        case LIL_EXPR_IDIV:
+            if (rf ? r.doubleVal_ == 0.0 : r.integerVal_ == 0) { return false; } // EERR_DIVISION_BY_ZERO
+            if (op == LIL_EXPR_MOD) {
+                if (!lf && !rf) { setInt(l.integerVal_%r.integerVal_); }
+                else { setFloat(fmod(lf ? l.doubleVal_ : CAST(double)l.integerVal_, rf ? r.doubleVal_ : CAST(double)r.integerVal_)); }
+            } else if (op == LIL_EXPR_DIV) {
+                setFloat((lf ? l.doubleVal_ : CAST(double)l.integerVal_)/(rf ? r.doubleVal_ : CAST(double)r.integerVal_));
+            } else {
+                if (!lf && !rf) { setInt(l.integerVal_/r.integerVal_); }
+                else { setInt(CAST(lilint_t)((lf ? l.doubleVal_ : CAST(double)l.integerVal_)/(rf ? r.doubleVal_ : CAST(double)r.integerVal_))); }
+            }
+            break;
+        case LIL_EXPR_ADD:
+            if (lf) { setFloat(rf ? r.doubleVal_+l.doubleVal_ : CAST(double)r.integerVal_+l.doubleVal_); }
+            else if (rf) { setFloat(r.doubleVal_+CAST(double)l.integerVal_); }
+            else { setInt(r.integerVal_+l.integerVal_); }
+            break;
+        case LIL_EXPR_SUB:
+            if (lf) { setFloat(rf ? l.doubleVal_-r.doubleVal_ : l.doubleVal_-CAST(double)r.integerVal_); }
+            else if (rf) { setFloat(CAST(double)l.integerVal_-r.doubleVal_); }
+            else { setInt(l.integerVal_-r.integerVal_); }
+            break;
+        case LIL_EXPR_SHL:
+        case LIL_EXPR_SHR:
+        case LIL_EXPR_BITAND:
+        case LIL_EXPR_BITOR: {
+            lilint_t li = lf ? CAST(lilint_t)l.doubleVal_ : l.integerVal_;
+            lilint_t ri = rf ? CAST(lilint_t)r.doubleVal_ : r.integerVal_;
+            if (op == LIL_EXPR_SHL)         { setInt(li << ri); }
+            else if (op == LIL_EXPR_SHR)    { setInt(li >> ri); }
+            else if (op == LIL_EXPR_BITAND) { setInt(li & ri); }
+            else                            { setInt(li | ri); }
+            break;
+        }
+        case LIL_EXPR_AND:
+            if (lf) { setInt((rf ? (l.doubleVal_ && r.doubleVal_) : (l.doubleVal_ && r.integerVal_))?1:0); }
+            else    { setInt((rf ? (l.integerVal_ && r.doubleVal_) : (l.integerVal_ && r.integerVal_))?1:0); }
+            break;
+        case LIL_EXPR_OR:
+            if (lf) { setInt((rf ? (l.doubleVal_ || r.doubleVal_) : (l.doubleVal_ || r.integerVal_))?1:0); }
+            else    { setInt((rf ? (l.integerVal_ || r.doubleVal_) : (l.integerVal_ || r.integerVal_))?1:0); }
+            break;
+        case LIL_EXPR_LT:
+        case LIL_EXPR_GT:
+        case LIL_EXPR_LE:
+        case LIL_EXPR_GE:
+        case LIL_EXPR_EQ:
+        case LIL_EXPR_NE:
+            if (!lf && !rf && op != LIL_EXPR_EQ) { // Ints are compared as ints except for "==".
+                lilint_t li = l.integerVal_, ri = r.integerVal_;
+                if (op == LIL_EXPR_LT)      { setInt((li < ri)?1:0); }
+                else if (op == LIL_EXPR_GT) { setInt((li > ri)?1:0); }
+                else if (op == LIL_EXPR_LE) { setInt((li <= ri)?1:0); }
+                else if (op == LIL_EXPR_GE) { setInt((li >= ri)?1:0); }
+                else                        { setInt((li != ri)?1:0); }
+            } else {
+                double ld = lf ? l.doubleVal_ : CAST(double)l.integerVal_;
+                double rd = rf ? r.doubleVal_ : CAST(double)r.integerVal_;
+                if (op == LIL_EXPR_LT)      { setInt((ld < rd)?1:0); }
+                else if (op == LIL_EXPR_GT) { setInt((ld > rd)?1:0); }
+                else if (op == LIL_EXPR_LE) { setInt((ld <= rd)?1:0); }
+                else if (op == LIL_EXPR_GE) { setInt((ld >= rd)?1:0); }
+                else if (op == LIL_EXPR_EQ) { setInt((ld == rd)?1:0); }
+                else                        { setInt((ld != rd)?1:0); }
+            }
+            break;
+        case LIL_EXPR_CONST:
+        case LIL_EXPR_VAR:
+        default:
+            assert(false);
+            break;
+    }
+    return true;
+}
+
+// Parses expression text with "$name" in it into Lil_exprNode the same way the parsing functions above would parse
+// the substituted text for any number the variables could be.  If the parse could come out differently for some
+// value, or there's an error, it gives up.  Functions return node index or -1 if it gave up.  Called from _ee_compile()
+struct Lil_exprCompiler { // #class
+    const std::vector<Lil_exprCell>& cells_;
+    Lil_exprProgram&                 prog_;
+    INT                              head_ = 0;
+    INT                              len_  = 0;
+
+    Lil_exprCompiler(const std::vector<Lil_exprCell>& cells, Lil_exprProgram& prog) // #ctor
+        : cells_(cells), prog_(prog), len_(CAST(INT)cells.size()) { }
+
+    ND bool isVar(INT n = 0) const { return head_ + n < len_ && cells_[CAST(size_t)(head_ + n)].var_ >= 0; }
+    // A variable starts with a digit or '-', where the parse only looks ahead any digit gives the same answer.
+    ND lchar ch(INT n = 0) const {
+        if (head_ + n >= len_) { return LC('\0'); }
+        return isVar(n) ? LC('0') : cells_[CAST(size_t)(head_ + n)].ch_;
+    }
+    ND bool at(lchar c) const { return !isVar() && ch() == c; } // Never used for '-' or digits.
+    ND bool valid() const { return head_ < len_; }
+    void skipSpaces() { while (head_ < len_ && !isVar() && LISSPACE(ch())) { head_++; } }
+
+    ND INT add(const Lil_exprNode& node) {
+        if (std::ssize(prog_.nodes_) >= Lil_exprProgram::MAX_NODES) { return -1; }
+        prog_.nodes_.push_back(node);
+        return CAST(INT)prog_.nodes_.size() - 1;
+    }
+    ND INT constant(const Lil_exprNum& num) { return add(Lil_exprNode{LIL_EXPR_CONST, 0, 0, num}); }
+    // Unary operator node on a, worked out now if a is a constant.  -1 if a is.
+    ND INT unaryOper(LIL_EXPR_OPCODE op, INT a) {
+        if (a < 0) { return -1; }
+        auto& nodes = prog_.nodes_;
+        Lil_exprNum num;
+        if (nodes[CAST(size_t)a].op_ == LIL_EXPR_CONST && _ee_apply(op, nodes[CAST(size_t)a].num_, num, num)) {
+            nodes[CAST(size_t)a].num_ = num;
+            return a;
+        }
+        return add(Lil_exprNode{op, a, 0, num});
+    }
+    // Binary operator node, worked out now if both sides are constants and it's not an error.  -1 if either side
+    // is, so an operand it gave up on never turns into something else.
+    ND INT binaryOper(LIL_EXPR_OPCODE op, INT a, INT b) {
+        if (a < 0 || b < 0) { return -1; }
+        auto& nodes = prog_.nodes_;
+        Lil_exprNum num;
+        if (nodes[CAST(size_t)a].op_ == LIL_EXPR_CONST && nodes[CAST(size_t)b].op_ == LIL_EXPR_CONST &&
+            _ee_apply(op, nodes[CAST(size_t)a].num_, nodes[CAST(size_t)b].num_, num)) {
+            nodes.pop_back(); // Constants are single nodes so a and b are the last two.
+            nodes[CAST(size_t)a].num_ = num;
+            return a;
+        }
+        return add(Lil_exprNode{op, a, b, num});
+    }
+
+    ND INT numeric() { // _ee_numeric_element()
+        Lil_exprNum num;
+        lilint_t fpart = 0, fpartlen = 1;
+        while (valid()) {
+            if (isVar()) { return -1; }
+            if (at(LC('.'))) {
+                if (num.type_ == EE_FLOAT) break;
+                num.type_ = EE_FLOAT;
+                head_++;
+                if (!valid() || isVar()) { return -1; }
+            } else if (!LISDIGIT(ch())) break;
+            if (num.type_ == EE_INT) { num.integerVal_ = num.integerVal_*10 + (ch() - LC('0')); }
+            else {
+                fpart = fpart*10 + (ch() - LC('0'));
+                fpartlen *= 10;
+            }
+            head_++;
+        }
+        if (num.type_ == EE_FLOAT) {
+            num.doubleVal_ = CAST(double)num.integerVal_ + CAST(double)fpart/CAST(double)fpartlen;
+        }
+        return constant(num);
+    }
+    ND INT paren() { // _ee_paren(), _ee_element()
+        skipSpaces();
+        if (at(LC('('))) {
+            head_++;
+            INT a = logicalOr();
+            if (a < 0) { return -1; }
+            skipSpaces();
+            if (!at(LC(')'))) { return -1; }
+            head_++;
+            return a;
+        }
+        if (isVar() || !LISDIGIT(ch())) { return -1; } // EERR_INVALID_EXPRESSION
+        return numeric();
+    }
+    ND INT unary() { // _ee_unaryOperators()
+        skipSpaces();
+        if (valid() && isVar()) {
+            // Whole value is one number (signed), as long as nothing after it would be read as more of it.
+            if (isVar(1) || ch(1) == LC('.') || LISDIGIT(ch(1))) { return -1; }
+            INT var = cells_[CAST(size_t)head_].var_;
+            head_++;
+            return add(Lil_exprNode{LIL_EXPR_VAR, var, 0, {}});
+        }
+        if (valid() && (at(LC('-')) || at(LC('+')) || at(LC('~')) || at(LC('!')))) {
+            lchar op = ch();
+            head_++;
+            INT a = unary();
+            if (op == LC('-')) { return unaryOper(LIL_EXPR_NEG, a); }
+            if (op == LC('~')) { return unaryOper(LIL_EXPR_BITNOT, a); }
+            if (op == LC('!')) { return unaryOper(LIL_EXPR_NOT, a); }
+            return a; // '+' doesn't change a thing.
+        }
+        return paren();
+    }
+    ND INT multipleDivide() {
+        INT a = unary();
+        skipSpaces();
+        while (a >= 0 && valid() && !_ee_invalidpunct(ch(1)) &&
+               (at(LC('*')) || at(LC('/')) || at(LC('\\')) || at(LC('%')))) {
+            lchar c = ch();
+            head_++;
+            auto op = c == LC('*') ? LIL_EXPR_MUL : c == LC('/') ? LIL_EXPR_DIV : c == LC('%') ? LIL_EXPR_MOD : LIL_EXPR_IDIV;
+            a = binaryOper(op, a, unary());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT addsub() {
+        INT a = multipleDivide();
+        skipSpaces();
+        while (a >= 0 && valid()) {
+            if (isVar()) { return -1; } // Negative value could be subtracted.
+            if (_ee_invalidpunct(ch(1)) || (!at(LC('+')) && !at(LC('-')))) break;
+            auto op = at(LC('+')) ? LIL_EXPR_ADD : LIL_EXPR_SUB;
+            head_++;
+            a = binaryOper(op, a, multipleDivide());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT shift() {
+        INT a = addsub();
+        skipSpaces();
+        while (a >= 0 && valid() && ((at(LC('<')) && ch(1) == LC('<')) || (at(LC('>')) && ch(1) == LC('>')))) {
+            auto op = at(LC('<')) ? LIL_EXPR_SHL : LIL_EXPR_SHR;
+            head_ += 2;
+            a = binaryOper(op, a, addsub());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT compare() {
+        INT a = shift();
+        skipSpaces();
+        while (a >= 0 && valid() && (at(LC('<')) || at(LC('>'))) && (!_ee_invalidpunct(ch(1)) || ch(1) == LC('='))) {
+            bool               eq = _ee_invalidpunct(ch(1));
+            LIL_EXPR_OPCODE    op = at(LC('<')) ? (eq ? LIL_EXPR_LE : LIL_EXPR_LT) : (eq ? LIL_EXPR_GE : LIL_EXPR_GT);
+            head_ += eq ? 2 : 1;
+            a = binaryOper(op, a, shift());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT equals() {
+        INT a = compare();
+        skipSpaces();
+        while (a >= 0 && valid() && (at(LC('=')) || at(LC('!'))) && ch(1) == LC('=')) {
+            auto op = at(LC('=')) ? LIL_EXPR_EQ : LIL_EXPR_NE;
+            head_ += 2;
+            a = binaryOper(op, a, compare());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT bitwiseAnd() {
+        INT a = equals();
+        skipSpaces();
+        while (a >= 0 && valid() && at(LC('&')) && !_ee_invalidpunct(ch(1))) {
+            head_++;
+            a = binaryOper(LIL_EXPR_BITAND, a, equals());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT bitwiseOr() {
+        INT a = bitwiseAnd();
+        skipSpaces();
+        while (a >= 0 && valid() && at(LC('|')) && !_ee_invalidpunct(ch(1))) {
+            head_++;
+            a = binaryOper(LIL_EXPR_BITOR, a, bitwiseAnd());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT logicalAnd() {
+        INT a = bitwiseOr();
+        skipSpaces();
+        while (a >= 0 && valid() && at(LC('&')) && ch(1) == LC('&')) {
+            head_ += 2;
+            a = binaryOper(LIL_EXPR_AND, a, bitwiseOr());
+            skipSpaces();
+        }
+        return a;
+    }
+    ND INT logicalOr() {
+        INT a = logicalAnd();
+        skipSpaces();
+        while (a >= 0 && valid() && at(LC('|')) && ch(1) == LC('|')) {
+            head_ += 2;
+            a = binaryOper(LIL_EXPR_OR, a, logicalAnd());
+            skipSpaces();
+        }
+        return a;
+    }
+};
+
+// Compile the substituted text of an expression, cells of "$name" stand for values of variables.
+// Called from _compile_expr()
+void _ee_compile(LilInterp_Ptr lil, Lil_exprProgram& prog, const std::vector<Lil_exprCell>& cells) { // #private
+    assert(lil!=nullptr);
+    prog.fallback_ = true;
+    prog.nodes_.clear();
+    if (prog.vars_.empty()) { // Nothing to substitute, just work it out now.
+        lstring text;
+        for (auto& cell : cells) { text.push_back(cell.ch_); }
+        Lil_exprVal ee(lil, new Lil_value(lil, text));
+        Lil_exprNum num;
+        if (!ee.isEmptyExpression()) {
+            _ee_expr(&ee);
+            if (ee.getError()) { return; } // Leave the error to the text way.
+            num.type_       = ee.getType();
+            num.integerVal_ = ee.getInteger();
+            num.doubleVal_  = ee.getDouble();
+        }
+        prog.nodes_.push_back(Lil_exprNode{LIL_EXPR_CONST, 0, 0, num});
+        prog.fallback_ = false;
+        return;
+    }
+    if (cells.empty() || (cells[0].var_ < 0 && !cells[0].ch_)) { return; }
+    Lil_exprCompiler comp(cells, prog);
+    if (comp.logicalOr() < 0) {
+        prog.nodes_.clear();
+        return;
+    }
+    prog.set_      = lil->find_sys_cmd(L_STR("set"));
+    prog.fallback_ = prog.set_ == nullptr;
+}
+
+// Value of a variable the way _ee_unaryOperators() would parse it, false if it isn't a plain number.
+ND static bool _ee_var_num(const lstring& text, Lil_exprNum& num) { // #private
+    size_t   i     = 0, len = text.length();
+    lilint_t fpart = 0, fpartlen = 1;
+    bool     neg   = len && text[0] == LC('-');
+    if (neg) { i++; }
+    if (i >= len || !LISDIGIT(text[i])) { return false; }
+    num.type_       = EE_INT;
+    num.integerVal_ = 0;
+    while (i < len) {
+        if (text[i] == LC('.')) {
+            if (num.type_ == EE_FLOAT) { return false; }
+            num.type_ = EE_FLOAT;
+            if (++i >= len || !LISDIGIT(text[i])) { return false; }
+        } else if (!LISDIGIT(text[i])) { return false; }
+        if (num.type_ == EE_INT) { num.integerVal_ = num.integerVal_*10 + (text[i] - LC('0')); }
+        else {
+            fpart = fpart*10 + (text[i] - LC('0'));
+            fpartlen *= 10;
+        }
+        i++;
+    }
+    if (num.type_ == EE_FLOAT) {
+        num.doubleVal_ = CAST(double)num.integerVal_ + CAST(double)fpart/CAST(double)fpartlen;
+        if (neg) { num.doubleVal_ = -num.doubleVal_; }
+    } else if (neg) { num.integerVal_ = -num.integerVal_; }
+    return true;
+}
+
+// Run compiled expression, false if it has to be done the text way (i.e. a variable isn't a plain number or
+// there's an error to report).  Called from lil_eval_expr()
+bool _ee_run(LilInterp_Ptr lil, const Lil_exprProgram& prog, Lil_exprNum& result) { // #private
+    assert(lil!=nullptr);
+    if (prog.fallback_) { return false; }
+    if (!prog.vars_.empty()) { // "$name" has to be the same as running "set name".
+        if (lil->getDollarPrefix() != L_STR("set ") || lil->find_cmd(L_STR("set"), lil->getSetSite()) != prog.set_ ||
+            lil->getCallback(LIL_CALLBACK_GETVAR) || lil->getParse_depth() + 1 >= lil->sysInfo_->limit_ParseDepth_) {
+            return false;
+        }
+    }
+    std::array<Lil_exprNum, Lil_exprProgram::MAX_NODES> vals;
+    size_t n = prog.nodes_.size();
+    for (size_t i = 0; i < n; i++) {
+        auto& node = prog.nodes_[i];
+        if (node.op_ == LIL_EXPR_CONST) {
+            vals[i] = node.num_;
+        } else if (node.op_ == LIL_EXPR_VAR) {
+            Lil_value_Ptr v = lil_get_var(lil, prog.vars_[CAST(size_t)node.a_].c_str());
+            if (v->getExactInteger(vals[i].integerVal_)) { vals[i].type_ = EE_INT; continue; }
+            if (!_ee_var_num(v->getValue(), vals[i])) { return false; }
+        } else if (!_ee_apply(node.op_, vals[CAST(size_t)node.a_], vals[CAST(size_t)node.b_], vals[i])) {
+            return false;
+        }
+    }
+    result = vals[n - 1];
+    return true;
+}
+
 #undef ND
 
 NS_END(LILNS)
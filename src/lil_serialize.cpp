@@ -241,12 +241,78 @@ bool SysInfo::serialize(SerializationFlags &flags) {
             keyValue(*g_writerPtr, "numCmdSuccess_", numCmdSuccess_);
             //    INT numCmdFailed_ = 0;
             keyValue(*g_writerPtr, "numCmdFailed_", numCmdFailed_);
+            //    INT numParseCacheHits_ = 0;
+            keyValue(*g_writerPtr, "numParseCacheHits_", numParseCacheHits_);
+            //    INT numParseCacheMisses_ = 0;
+            keyValue(*g_writerPtr, "numParseCacheMisses_", numParseCacheMisses_);
+            //    INT numBytecodeCompiles_ = 0;
+            keyValue(*g_writerPtr, "numBytecodeCompiles_", numBytecodeCompiles_);
+            //    INT numBytecodeFallbacks_ = 0;
+            keyValue(*g_writerPtr, "numBytecodeFallbacks_", numBytecodeFallbacks_);
+            //    INT numBytecodeRuns_ = 0;
+            keyValue(*g_writerPtr, "numBytecodeRuns_", numBytecodeRuns_);
+            //    INT numExprCacheHits_ = 0;
+            keyValue(*g_writerPtr, "numExprCacheHits_", numExprCacheHits_);
+            //    INT numExprCacheMisses_ = 0;
+            keyValue(*g_writerPtr, "numExprCacheMisses_", numExprCacheMisses_);
+            //    INT numExprFallbacks_ = 0;
+            keyValue(*g_writerPtr, "numExprFallbacks_", numExprFallbacks_);
+            //    INT numDirectVarReads_ = 0;
+            keyValue(*g_writerPtr, "numDirectVarReads_", numDirectVarReads_);
+            //    INT numCmdSiteHits_ = 0;
+            keyValue(*g_writerPtr, "numCmdSiteHits_", numCmdSiteHits_);
+            //    INT numCmdSiteMisses_ = 0;
+            keyValue(*g_writerPtr, "numCmdSiteMisses_", numCmdSiteMisses_);
+            //    INT numCmdTableChanges_ = 0; // Times a command table changed, see Lil_newCmdEpoch().
+            keyValue(*g_writerPtr, "numCmdTableChanges_", numCmdTableChanges_);
+            //    INT numSlotVars_ = 0;
+            keyValue(*g_writerPtr, "numSlotVars_", numSlotVars_);
+            //    INT numSymbols_ = 0;
+            keyValue(*g_writerPtr, "numSymbols_", numSymbols_);
+            //    INT numValueRepHits_ = 0;
+            keyValue(*g_writerPtr, "numValueRepHits_", numValueRepHits_);
+            //    INT numValueStrGens_ = 0;
+            keyValue(*g_writerPtr, "numValueStrGens_", numValueStrGens_);
+            //    INT numValueCowCopies_ = 0;
+            keyValue(*g_writerPtr, "numValueCowCopies_", numValueCowCopies_);
+            //    INT numListRepHits_ = 0;
+            keyValue(*g_writerPtr, "numListRepHits_", numListRepHits_);
+            //    INT numListRepBuilds_ = 0;
+            keyValue(*g_writerPtr, "numListRepBuilds_", numListRepBuilds_);
+            //    INT numListRepCopies_ = 0;
+            keyValue(*g_writerPtr, "numListRepCopies_", numListRepCopies_);
+            //    INT numListInPlace_ = 0;
+            keyValue(*g_writerPtr, "numListInPlace_", numListInPlace_);
+            //    INT numDictInPlace_ = 0;
+            keyValue(*g_writerPtr, "numDictInPlace_", numDictInPlace_);
+            //    INT numDictRehashes_ = 0;
+            keyValue(*g_writerPtr, "numDictRehashes_", numDictRehashes_);
+            //    INT numPoolHits_ = 0;
+            keyValue(*g_writerPtr, "numPoolHits_", numPoolHits_);
+            //    INT numPoolMisses_ = 0;
+            keyValue(*g_writerPtr, "numPoolMisses_", numPoolMisses_);
+            //    INT numEnvReuses_ = 0;
+            keyValue(*g_writerPtr, "numEnvReuses_", numEnvReuses_);
+            //    INT numTailCalls_ = 0;
+            keyValue(*g_writerPtr, "numTailCalls_", numTailCalls_);
+            //    INT numCountedTests_ = 0;
+            keyValue(*g_writerPtr, "numCountedTests_", numCountedTests_);
             //    INT varHTinitSize_    = 0; // 0 is unset
             keyValue(*g_writerPtr, "varHTinitSize_", varHTinitSize_);
             //    INT cmdHTinitSize_    = 0; // 0 is unset
             keyValue(*g_writerPtr, "cmdHTinitSize_", cmdHTinitSize_);
             //    INT limit_ParseDepth_ = 0xFFFF; // 0 is off
             keyValue(*g_writerPtr, "limit_ParseDepth_", limit_ParseDepth_);
+            //    INT parseCacheMaxSize_    = 1024;   // Max entries in parsed code cache, 0 is off
+            keyValue(*g_writerPtr, "parseCacheMaxSize_", parseCacheMaxSize_);
+            //    INT parseCacheMaxCodeLen_ = 0x1000; // Longer code is parsed but not cached
+            keyValue(*g_writerPtr, "parseCacheMaxCodeLen_", parseCacheMaxCodeLen_);
+            //    INT funcBytecode_         = 1;      // Run func bodies as bytecode when they compile, 0 is off
+            keyValue(*g_writerPtr, "funcBytecode_", funcBytecode_);
+            //    INT exprCacheMaxSize_     = 1024;   // Max entries in compiled expression cache, 0 is off
+            keyValue(*g_writerPtr, "exprCacheMaxSize_", exprCacheMaxSize_);
+            //    INT countedLoops_         = 1;      // Run counted for/while loops with native integers, 0 is off
+            keyValue(*g_writerPtr, "countedLoops_", countedLoops_);
         }
     } // End json object
 
@@ -266,8 +332,8 @@ bool Lil_var::serialize(SerializationFlags &flags) {
         keyValue(*g_writerPtr, "watchCode_", watchCode_);
     }
 
-    //    lstring             name_; // Variable named.
-    keyValue(*g_writerPtr, "name_", name_);
+    //    Lil_sym             name_; // Variable named.
+    keyValue(*g_writerPtr, "name_", name_->name_);
 
     //    Lil_callframe *     thisCallframe_ = nullptr; // Pointer to callframe defined in.
     if (flags.flags_[LILVAR_THISCALLFRAME]) {
@@ -304,18 +370,33 @@ bool Lil_callframe::serialize(SerializationFlags &flags) {
         genPtr("parent_", parent_);
 
         if (flags.flags_[LILCALLFRAME_VARMAP]) {
-        //     using Var_HashTable = std::unordered_map<lstring,Lil_var_Ptr>;
+        //     using Var_HashTable = std::unordered_map<Lil_sym,Lil_var_Ptr,Lil_symHash>;
         //    Var_HashTable varmap_; // Hashmap of variables in callframe.
             JsonArray<rapidjson::PrettyWriter<rapidjson::FileWriteStream>>   object8(*g_writerPtr, "varmap_");
             for (const auto &elem: varmap_) {
                 {
                     JsonObject<rapidjson::PrettyWriter<rapidjson::FileWriteStream>> object9(*g_writerPtr);
-                    keyValue(*g_writerPtr, "name", elem.first);
+                    keyValue(*g_writerPtr, "name", elem.first->name_);
                     ret = elem.second->serialize(flags);
                     if (!ret) return ret;
                 } // End json object
             }
         } // End json array
+        //    Lil_slotNames_Ptr                         slotNames_; // Names of variables in slots_ (can be nullptr).
+        //    std::unique_ptr<std::optional<Lil_var>[]> slots_;     // Variables by slot, empty until set.
+        if (flags.flags_[LILCALLFRAME_VARMAP] && slotNames_) {
+            JsonArray<rapidjson::PrettyWriter<rapidjson::FileWriteStream>>   object8(*g_writerPtr, "slots_");
+            for (INT i = 0; i < std::ssize(*slotNames_); i++) {
+                {
+                    JsonObject<rapidjson::PrettyWriter<rapidjson::FileWriteStream>> object9(*g_writerPtr);
+                    keyValue(*g_writerPtr, "name", (*slotNames_)[CAST(size_t)i]->name_);
+                    if (getSlotVar(i)) {
+                        ret = getSlotVar(i)->serialize(flags);
+                        if (!ret) return ret;
+                    }
+                } // End json object
+            }
+        } // End json array
         //    Lil_func_Ptr  func_        = nullptr; // The function that generated this callframe.
         if (func_ == nullptr) {
             keyNull(*g_writerPtr, "func_");
@@ -341,6 +422,15 @@ bool Lil_callframe::serialize(SerializationFlags &flags) {
         keyValue(*g_writerPtr, "retval_set_", "retval_set_");
         //    bool          breakRun_ = false;
         keyValue(*g_writerPtr, "breakRun_", "breakRun_");
+        //    Lil_list_Ptr  tailCall_    = nullptr; // Words of command "tailcall" runs in place of func_ (own memory).
+        if (tailCall_ == nullptr) {
+            keyNull(*g_writerPtr, "tailCall_");
+        } else {
+            JsonArray<rapidjson::PrettyWriter<rapidjson::FileWriteStream>> object(*g_writerPtr, "tailCall_");
+            for (int i = 0; i < tailCall_->getCount(); i++) {
+                keyValue(*g_writerPtr, "tailCall_", tailCall_->getValue(i)->getValue());
+            }
+        }
     } // End json object
 
     return ret;
@@ -349,10 +439,10 @@ bool Lil_callframe::serialize(SerializationFlags &flags) {
 bool Lil_func::serialize(SerializationFlags &flags) {
     bool ret = false;
     // class Lil_func
-    // lstring         name_; // Name of function.
+    // Lil_sym         name_; // Name of function.
     genId(this);
     keyValue(*g_writerPtr, "type", "Lil_func");
-    keyValue(*g_writerPtr, "orgName", name_);
+    keyValue(*g_writerPtr, "orgName", name_->name_);
 
     // SysInfo*        sysInfo_ = nullptr;
     // Lil_list_Ptr    argNames_ = nullptr; // List of arguments to function. Owns memory.
@@ -382,6 +472,15 @@ bool Lil_func::serialize(SerializationFlags &flags) {
             genPtr("proc_", &proc_);
         }
     }
+    // lil_cmd_fn_t    fn_       = nullptr; // Function pointer of binary command, from lil_register_fn(). #optimization
+    // void*           fnCtx_    = nullptr; // Given to fn_.
+    if (flags.flags_[LILFUNC_PROC]) {
+        if (fn_ == nullptr) {
+            keyNull(*g_writerPtr, "fn_");
+        } else {
+            genPtr("fnCtx_", fnCtx_);
+        }
+    }
     ret = true;
     return ret;
 }
@@ -441,6 +540,8 @@ bool LilInterp::serialize(SerializationFlags &flags) {
         //lstring err_msg_; // Error message.
         keyValue(*g_writerPtr, "err_msg_", err_msg_);
 
+        //    INT            cmdEpoch_ = 0; // Changes whenever cmdMap_ does, see Lil_cmdSite. #optimization
+        keyValue(*g_writerPtr, "cmdEpoch_", cmdEpoch_);
         //    Cmds_HashTable cmdMap_;    // Hashmap of "commands".
         if (flags.flags_[LILINTERP_CMDMAP])
         {
@@ -448,35 +549,45 @@ bool LilInterp::serialize(SerializationFlags &flags) {
             for (const auto &elem: cmdMap_) {
                 {
                     JsonObject<rapidjson::PrettyWriter<rapidjson::FileWriteStream>> object2(*g_writerPtr);
-                    keyValue(*g_writerPtr, "name", elem.first);
+                    keyValue(*g_writerPtr, "name", elem.first->name_);
                     ret = elem.second->serialize(flags);
                     if (!ret) return ret;
                 } // End json object
             }
         } // End json array
         // ===============
-        //    Cmds_HashTable sysCmdMap_; // Hashmap of initial or system "commands".
-        if (flags.flags_[LILINTERP_SYSCMDMAP]) {
-            JsonArray<rapidjson::PrettyWriter<rapidjson::FileWriteStream>>   object3(*g_writerPtr, "sysCmdMap_");
-            for (const auto &elem: sysCmdMap_) {
+        //    const std::vector<Lil_func_Ptr>* builtinCmds_ = nullptr;
+        if (flags.flags_[LILINTERP_SYSCMDMAP] && builtinCmds_ != nullptr) {
+            JsonArray<rapidjson::PrettyWriter<rapidjson::FileWriteStream>>   object3(*g_writerPtr, "builtinCmds_");
+            for (const auto &elem: *builtinCmds_) {
+                if (!elem) { continue; }
                 {
                     JsonObject<rapidjson::PrettyWriter<rapidjson::FileWriteStream>> object4(*g_writerPtr);
-                    keyValue(*g_writerPtr, "name", elem.first);
-                    ret = elem.second->serialize(flags);
+                    keyValue(*g_writerPtr, "name", elem->getName());
+                    ret = elem->serialize(flags);
                     if (!ret) return ret;
                 } // End json object
             }
         } // End json array
+        //    std::bitset<LIL_MAX_BUILTINS>    builtinHidden_; // Builtins not named by their name here (deleted, renamed or redefined).
+        keyValue(*g_writerPtr, "builtinHidden_", builtinHidden_.to_string());
+        //    std::bitset<LIL_MAX_BUILTINS>    builtinErased_; // Builtins redefined, find_sys_cmd() doesn't give these.
+        keyValue(*g_writerPtr, "builtinErased_", builtinErased_.to_string());
         // ==========
         //    lstring dollarPrefix_; // own memory
         keyValue(*g_writerPtr, "dollarPrefix_", dollarPrefix_);
-        //    lstring code_; /* need save on parse */ // Waste some space owning, but simplify conception.
-        if (flags.flags_[LILINTERP_CODE])
-            keyValue(*g_writerPtr, "code_", code_);
-        //    INT     head_     = 0; // Position in code_ (need save on parse)
-        keyValue(*g_writerPtr, "head_", head_);
-        //    INT     codeLen_  = 0; // Length of code_  (need save on parse)
-        keyValue(*g_writerPtr, "codeLen_", codeLen_);
+        //    Lil_parseCursor              cursor_;  // Code being parsed now.
+        if (flags.flags_[LILINTERP_CODE]) {
+            if (cursor_.code_ == nullptr) {
+                keyNull(*g_writerPtr, "code_");
+            } else {
+                keyValue(*g_writerPtr, "code_", lstring(cursor_.code_, CAST(size_t)cursor_.codeLen_));
+            }
+        }
+        keyValue(*g_writerPtr, "head_", cursor_.head_);
+        keyValue(*g_writerPtr, "codeLen_", cursor_.codeLen_);
+        //    std::vector<Lil_parseCursor> cursors_; // Code of outer parses, restored by popCode().
+        keyValue(*g_writerPtr, "codeDepth_", CAST(INT)cursors_.size());
         //    lcstrp  rootCode_ = nullptr; // The original code_
         if (flags.flags_[LILINTERP_ROOTCODE]) {
             if (rootCode_ == nullptr) {
@@ -517,6 +628,8 @@ bool LilInterp::serialize(SerializationFlags &flags) {
                 if (!ret) return ret;
             }
         }
+        //    std::vector<Lil_callframe_Ptr> freeEnvs_; // Retired callframes, reused by lil_push_env(). #optimization
+        keyValue(*g_writerPtr, "numFreeEnvs_", CAST(INT)freeEnvs_.size());
         //    Lil_value_Ptr       empty_                   = nullptr; // A "empty" Lil_value. (own memory)
         //    std::vector<lil_callback_proc_t> callback_{NUM_CALLBACKS}; // index LIL_CALLBACK_*
         //    lstring   catcher_; // Pointer to "catch" command (own memory)
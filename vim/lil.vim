@@ -19,9 +19,9 @@ endif
 " function
 syn keyword lilFunction     reflect func rename unusedname quote set local write print eval topeval
 syn keyword lilFunction     upeval downeval enveval jaileval count index indexof filter list append slice
-syn keyword lilFunction     subst concat foreach return expr inc dec read store if while for
+syn keyword lilFunction     subst concat foreach return tailcall expr inc dec read store if while for
 syn keyword lilFunction     char charat codeat substr strpos length trim ltrim rtrim strcmp
-syn keyword lilFunction     streq repstr split try error exit source lmap rand catcher
+syn keyword lilFunction     streq repstr split try error exit source lmap lset lreplace dict rand catcher
 
 " LIL Variables for $blah
 " syn match lilVarRef "$\(\([^;$[\]{}"' 	]*\)\|\({[^}]*}\)\|\(\"[^\"]*\"\)\|\(\'[^\']*\'\)\)"